@@ -54,7 +54,12 @@ namespace amrex
 
 	if (smf.size() == 1)
 	{
-	    mf.ParallelCopy(*smf[0], scomp, dcomp, ncomp, IntVect{0}, mf.nGrowVect(), geom.periodicity());
+            if (&mf == smf[0] && scomp == dcomp) {
+                // filling the ghost cells of mf in place
+                mf.FillBoundary(dcomp, ncomp, geom.periodicity());
+            } else {
+                mf.ParallelCopy(*smf[0], scomp, dcomp, ncomp, IntVect{0}, mf.nGrowVect(), geom.periodicity());
+            }
 	}
 	else if (smf.size() == 2)
 	{
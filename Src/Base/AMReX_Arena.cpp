@@ -3,6 +3,7 @@
 #include <AMReX_BArena.H>
 #include <AMReX_CArena.H>
 #include <AMReX_DArena.H>
+#include <AMReX_SArena.H>
 
 #include <AMReX.H>
 #include <AMReX_Print.H>
@@ -22,6 +23,26 @@ namespace {
 
     bool use_buddy_allocator = false;
     long buddy_allocator_size = 0L;
+    bool use_size_class_arena = false;
+
+    void PrintSArenaUsage (const SArena* p, const std::string& name)
+    {
+        const int IOProc = ParallelDescriptor::IOProcessorNumber();
+        long kilobytes[2] = { static_cast<long>(p->heap_space_used() / 1024),
+                              static_cast<long>(p->bytes_in_use() / 1024) };
+        long nalloc, nhits;
+        p->alloc_count(nalloc, nhits);
+        long max_kilobytes[2] = { kilobytes[0], kilobytes[1] };
+        ParallelDescriptor::ReduceLongMin(kilobytes, 2, IOProc);
+        ParallelDescriptor::ReduceLongMax(max_kilobytes, 2, IOProc);
+        ParallelDescriptor::ReduceLongSum(nalloc, IOProc);
+        ParallelDescriptor::ReduceLongSum(nhits, IOProc);
+        amrex::Print() << "[" << name << "] space (kilobyte) used spread across MPI: ["
+                       << kilobytes[0] << " ... " << max_kilobytes[0] << "], in use: ["
+                       << kilobytes[1] << " ... " << max_kilobytes[1] << "]\n"
+                       << "[" << name << "] " << nalloc << " allocations, "
+                       << nhits << " from thread caches\n";
+    }
 }
 
 const unsigned int Arena::align_size;
@@ -99,6 +120,7 @@ Arena::Initialize ()
     ParmParse pp("amrex");
     pp.query("use_buddy_allocator", use_buddy_allocator);
     pp.query("buddy_allocator_size", buddy_allocator_size);
+    pp.query("use_size_class_arena", use_size_class_arena);
 
 #ifdef AMREX_USE_GPU
     if (use_buddy_allocator)
@@ -112,6 +134,14 @@ Arena::Initialize ()
     }
     else
 #endif
+    if (use_size_class_arena)
+    {
+#ifdef AMREX_USE_GPU
+        amrex::Abort("amrex.use_size_class_arena: SArena needs host memory, it cannot be The_Arena of a GPU build");
+#endif
+        the_arena = new SArena(0, ArenaInfo().SetPreferred());
+    }
+    else
     {
 #if defined(BL_COALESCE_FABS) || defined(AMREX_USE_GPU)
         the_arena = new CArena(0, ArenaInfo().SetPreferred());
@@ -160,6 +190,9 @@ Arena::PrintUsage ()
     if (amrex::Verbose() > 0) {
         const int IOProc   = ParallelDescriptor::IOProcessorNumber();
         if (The_Arena()) {
+            if (const SArena* sp = dynamic_cast<SArena*>(The_Arena())) {
+                PrintSArenaUsage(sp, "The         Arena");
+            }
             CArena* p = dynamic_cast<CArena*>(The_Arena());
             if (p) {
                 long min_kilobytes = p->heap_space_used() / 1024;
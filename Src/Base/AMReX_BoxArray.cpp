@@ -1,10 +1,12 @@
 
+#include <AMReX.H>
 #include <AMReX_BLassert.H>
 #include <AMReX_BoxArray.H>
 #include <AMReX_ParallelDescriptor.H>
 #include <AMReX_Utility.H>
 #include <AMReX_MFIter.H>
 #include <AMReX_BaseFab.H>
+#include <AMReX_Print.H>
 
 #ifdef BL_MEM_PROFILING
 #include <AMReX_MemProfiler.H>
@@ -24,6 +26,9 @@ long BARef::total_box_bytes_hwm  = 0L;
 long BARef::total_hash_bytes     = 0L;
 long BARef::total_hash_bytes_hwm = 0L;
 #endif
+long   BARef::num_hash_builds       = 0L;
+double BARef::total_hash_build_time = 0.0;
+long   BARef::max_hash_bytes        = 0L;
 
 bool    BARef::initialized = false;
 bool BoxArray::initialized = false;
@@ -208,12 +213,8 @@ BARef::updateMemoryUsage_box (int s)
 void
 BARef::updateMemoryUsage_hash (int s)
 {
-    if (hash.size() > 0) {
-	long b = sizeof(hash);
-	for (const auto& x: hash) {
-	    b += amrex::gcc_map_node_extra_bytes
-		+ sizeof(IntVect) + amrex::bytesOf(x.second);
-	}
+    if (!hash.empty()) {
+	long b = hash.bytes();
 	if (s > 0) {
 	    total_hash_bytes += b;
 	    total_hash_bytes_hwm = std::max(total_hash_bytes_hwm, total_hash_bytes);
@@ -251,6 +252,16 @@ BARef::Initialize ()
 void
 BARef::Finalize ()
 {
+    if (amrex::system::verbose > 1 && num_hash_builds > 0) {
+        amrex::Print() << "BoxArray index: " << num_hash_builds << " builds in "
+                       << total_hash_build_time << " seconds, largest "
+                       << max_hash_bytes << " bytes\n";
+    }
+
+    num_hash_builds = 0;
+    total_hash_build_time = 0.0;
+    max_hash_bytes = 0;
+
     initialized = false;
 }
 
@@ -1094,7 +1105,7 @@ BoxArray::intersections (const Box&                         bx,
 {
   // This is called too many times BL_PROFILE("BoxArray::intersections()");
 
-    BARef::HashType& BoxHashMap = getHashMap();
+    const BARef::HashType& BoxHashMap = getHashMap();
 
     isects.resize(0);
 
@@ -1110,40 +1121,23 @@ BoxArray::intersections (const Box&                         bx,
 	const IntVect& doihi = getDoiHi();
 
 	gbx.setSmall(glo - doihi).setBig(ghi + doilo);
-        gbx.refine(m_crse_ratio).coarsen(m_ref->crsn);
-	
-        const IntVect& sm = amrex::max(gbx.smallEnd()-1, m_ref->bbox.smallEnd());
-        const IntVect& bg = amrex::min(gbx.bigEnd(),     m_ref->bbox.bigEnd());
-
-        Box cbx(sm,bg);
-        cbx.normalize();
-
-	if (!cbx.intersects(m_ref->bbox)) return;
-
-	auto TheEnd = BoxHashMap.cend();
+        gbx.refine(m_crse_ratio);
 
         bool super_simple = m_simple && m_crse_ratio==1 && m_typ.cellCentered();
         auto& abox = m_ref->m_abox;
 
-        for (IntVect iv = cbx.smallEnd(), End = cbx.bigEnd(); iv <= End; cbx.next(iv))
+        BoxHashMap.query(gbx, [&] (int index) -> bool
         {
-            auto it = BoxHashMap.find(iv);
+            const Box& ibox = super_simple ? abox[index] : (*this)[index];
+            const Box& isect = bx & amrex::grow(ibox,ng);
 
-            if (it != TheEnd)
+            if (isect.ok())
             {
-                for (const int index : it->second)
-                {
-                    const Box& ibox = super_simple ? abox[index] : (*this)[index];
-                    const Box& isect = bx & amrex::grow(ibox,ng);
-
-                    if (isect.ok())
-                    {
-                        isects.push_back(std::pair<int,Box>(index,isect));
-			if (first_only) return;
-                    }
-                }
+                isects.push_back(std::pair<int,Box>(index,isect));
+                if (first_only) return true;
             }
-        }
+            return false;
+        });
     }
 }
 
@@ -1164,7 +1158,7 @@ BoxArray::complementIn (BoxList& bl, const Box& bx) const
 
     if (!empty()) 
     {
-	BARef::HashType& BoxHashMap = getHashMap();
+	const BARef::HashType& BoxHashMap = getHashMap();
 
 	BL_ASSERT(bx.ixType() == ixType());
 
@@ -1176,17 +1170,7 @@ BoxArray::complementIn (BoxList& bl, const Box& bx) const
 	const IntVect& doihi = getDoiHi();
 
 	gbx.setSmall(glo - doihi).setBig(ghi + doilo);
-        gbx.refine(m_crse_ratio).coarsen(m_ref->crsn);
-	
-        const IntVect& sm = amrex::max(gbx.smallEnd()-1, m_ref->bbox.smallEnd());
-        const IntVect& bg = amrex::min(gbx.bigEnd(),     m_ref->bbox.bigEnd());
-
-        Box cbx(sm,bg);
-        cbx.normalize();
-
-	if (!cbx.intersects(m_ref->bbox)) return;
-
-	auto TheEnd = BoxHashMap.cend();
+        gbx.refine(m_crse_ratio);
 
         BoxList newbl(bl.ixType());
         newbl.reserve(bl.capacity());
@@ -1195,32 +1179,23 @@ BoxArray::complementIn (BoxList& bl, const Box& bx) const
         bool super_simple = m_simple && m_crse_ratio==1 && m_typ.cellCentered();
         auto& abox = m_ref->m_abox;
 
-	for (IntVect iv = cbx.smallEnd(), End = cbx.bigEnd(); 
-	     iv <= End && bl.isNotEmpty(); 
-	     cbx.next(iv))
+        BoxHashMap.query(gbx, [&] (int index) -> bool
         {
-            auto it = BoxHashMap.find(iv);
+            const Box& isect = (super_simple)
+                ? (bx & abox[index])
+                : (bx & (*this)[index]);
 
-            if (it != TheEnd)
+            if (isect.ok())
             {
-                for (const int index : it->second)
-                {
-                    const Box& isect = (super_simple)
-                        ? (bx & abox[index])
-                        : (bx & (*this)[index]);
-
-                    if (isect.ok())
-                    {
-                        newbl.clear();
-                        for (const Box& b : bl) {
-                            amrex::boxDiff(newdiff, b, isect);
-                            newbl.join(newdiff);
-                        }
-                        bl.swap(newbl);
-                    }
+                newbl.clear();
+                for (const Box& b : bl) {
+                    amrex::boxDiff(newdiff, b, isect);
+                    newbl.join(newdiff);
                 }
+                bl.swap(newbl);
             }
-        }
+            return bl.isEmpty();
+        });
     }
 }
 
@@ -1288,7 +1263,7 @@ BoxArray::removeOverlap (bool simplify)
                 for (const Box& b : bl_diff)
                 {
                     m_ref->m_abox.push_back(b);
-                    BoxHashMap[amrex::coarsen(b.smallEnd(),m_ref->crsn)].push_back(size()-1);
+                    BoxHashMap.insert(size()-1, m_ref->m_abox);
                 }
             }
         }
@@ -1362,31 +1337,15 @@ BoxArray::getHashMap () const
     {
         if (BoxHashMap.empty() && size() > 0)
         {
-            //
-            // Calculate the bounding box & maximum extent of the boxes.
-            //
-	    IntVect maxext = IntVect::TheUnitVector();
-            Box boundingbox = m_ref->m_abox[0];
-
-	    const int N = size();
-	    for (int i = 0; i < N; ++i)
-            {
-                const Box& bx = m_ref->m_abox[i];
-                maxext = amrex::max(maxext, bx.size());
-                boundingbox.minBox(bx);
-            }
+            BoxHashMap.build(m_ref->m_abox);
 
-            for (int i = 0; i < N; i++)
-            {
-                const IntVect& crsnsmlend 
-		    = amrex::coarsen(m_ref->m_abox[i].smallEnd(),maxext);
-                BoxHashMap[crsnsmlend].push_back(i);
-            }
-
-            m_ref->crsn = maxext;
-            m_ref->bbox =boundingbox.coarsen(maxext);
-            m_ref->bbox.normalize();
+            ++BARef::num_hash_builds;
+            BARef::total_hash_build_time += BoxHashMap.buildTime();
+            BARef::max_hash_bytes = std::max(BARef::max_hash_bytes, BoxHashMap.bytes());
 
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
 	    m_ref->has_hashmap = true;
 
 #ifdef BL_MEM_PROFILING
@@ -0,0 +1,176 @@
+
+#include <map>
+#include <numeric>
+
+#include <AMReX_BoxIndex.H>
+#include <AMReX_Utility.H>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace amrex {
+
+namespace {
+    // smallest power of two >= n
+    int pow2_ceil (int n)
+    {
+        int r = 1;
+        while (r < n) r *= 2;
+        return r;
+    }
+}
+
+void
+BoxIndex::clear ()
+{
+    m_groups.clear();
+    m_extra.clear();
+    m_nbuilt = 0;
+}
+
+void
+BoxIndex::build (const Vector<Box>& boxes)
+{
+    const double t0 = amrex::second();
+
+    clear();
+
+    const int N = boxes.size();
+    m_nbuilt = N;
+    if (N == 0) return;
+
+    //
+    // The bucket size of each box, its size rounded up to powers of two.
+    //
+    std::vector<IntVect> bsize(N);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int i = 0; i < N; ++i) {
+        const IntVect& sz = boxes[i].size();
+        bsize[i] = IntVect(AMREX_D_DECL(pow2_ceil(sz[0]), pow2_ceil(sz[1]), pow2_ceil(sz[2])));
+    }
+
+    std::map<IntVect,int> count;
+    for (int i = 0; i < N; ++i) {
+        if (boxes[i].ok()) ++count[bsize[i]];
+    }
+    if (count.empty()) return;
+
+    //
+    // Groups with few boxes go into one with the largest bucket size among
+    // them, so that a query does not have to visit many small groups.
+    //
+    const int nmin = std::max(16, N/64);
+    std::map<IntVect,int> gid;
+    IntVect small_crsn = IntVect::TheUnitVector();
+    bool has_small = false;
+    for (const auto& kv : count) {
+        if (kv.second >= nmin) {
+            const int g = m_groups.size();
+            gid[kv.first] = g;
+            m_groups.emplace_back();
+            m_groups.back().crsn = kv.first;
+        } else {
+            small_crsn = amrex::max(small_crsn, kv.first);
+            has_small = true;
+        }
+    }
+    if (has_small) {
+        const int g = m_groups.size();
+        for (const auto& kv : count) {
+            if (kv.second < nmin) gid[kv.first] = g;
+        }
+        m_groups.emplace_back();
+        m_groups.back().crsn = small_crsn;
+    }
+
+    std::vector<std::vector<int> > members(m_groups.size());
+    for (int i = 0; i < N; ++i) {
+        if (boxes[i].ok()) members[gid[bsize[i]]].push_back(i);
+    }
+
+    const int ngroups = m_groups.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int ig = 0; ig < ngroups; ++ig)
+    {
+        Group& g = m_groups[ig];
+        const std::vector<int>& ids = members[ig];
+        const int n = ids.size();
+
+        std::vector<IntVect> civ(n);
+        for (int j = 0; j < n; ++j) {
+            civ[j] = amrex::coarsen(boxes[ids[j]].smallEnd(), g.crsn);
+        }
+
+        g.cbox = Box(civ[0], civ[0]);
+        for (const auto& iv : civ) {
+            g.cbox.minBox(Box(iv,iv));
+        }
+
+        // a dense offset array is used unless most of the buckets are empty
+        const long nbuckets = g.cbox.numPts();
+        g.dense = nbuckets <= 4L*n + 64;
+
+        std::vector<long> key(n);
+        for (int j = 0; j < n; ++j) {
+            key[j] = g.cbox.index(civ[j]);
+        }
+
+        if (g.dense)
+        {
+            g.offset.assign(nbuckets+1, 0);
+            for (int j = 0; j < n; ++j) ++g.offset[key[j]+1];
+            std::partial_sum(g.offset.begin(), g.offset.end(), g.offset.begin());
+            g.ids.resize(n);
+            std::vector<int> pos(g.offset.begin(), g.offset.end()-1);
+            for (int j = 0; j < n; ++j) {
+                g.ids[pos[key[j]]++] = ids[j];
+            }
+        }
+        else
+        {
+            std::vector<int> order(n);
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(),
+                             [&] (int a, int b) { return key[a] < key[b]; });
+            g.ids.resize(n);
+            for (int j = 0; j < n; ++j) {
+                const int o = order[j];
+                g.ids[j] = ids[o];
+                if (g.keys.empty() || g.keys.back() != key[o]) {
+                    g.keys.push_back(key[o]);
+                    g.offset.push_back(j);
+                }
+            }
+            g.offset.push_back(n);
+        }
+    }
+
+    m_build_time = amrex::second() - t0;
+}
+
+void
+BoxIndex::insert (int i, const Vector<Box>& boxes)
+{
+    m_extra.push_back(i);
+    if (m_extra.size() > std::max<std::size_t>(64, m_nbuilt/8)) {
+        build(boxes);
+    }
+}
+
+long
+BoxIndex::bytes () const
+{
+    long r = sizeof(BoxIndex) + amrex::bytesOf(m_extra);
+    for (const auto& g : m_groups) {
+        r += sizeof(Group) + amrex::bytesOf(g.keys) + amrex::bytesOf(g.offset)
+            + amrex::bytesOf(g.ids);
+    }
+    return r;
+}
+
+}
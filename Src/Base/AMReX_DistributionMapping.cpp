@@ -1,6 +1,7 @@
 
 #include <AMReX_BoxArray.H>
 #include <AMReX_MultiFab.H>
+#include <AMReX_LayoutData.H>
 #include <AMReX_DistributionMapping.H>
 #include <AMReX_ParmParse.H>
 #include <AMReX_BLProfiler.H>
@@ -10,6 +11,7 @@
 #endif
 #include <AMReX_VisMF.H>
 #include <AMReX_Utility.H>
+#include <AMReX_Machine.H>
 
 #include <iostream>
 #include <fstream>
@@ -38,6 +40,8 @@ namespace amrex {
     int    sfc_threshold;
     Real   max_efficiency;
     int    node_size;
+    int    graph_ngrow;
+    Real   graph_imbalance;
 
 // We default to SFC.
 DistributionMapping::Strategy DistributionMapping::m_Strategy = DistributionMapping::SFC;
@@ -75,6 +79,9 @@ DistributionMapping::strategy (DistributionMapping::Strategy how)
     case RRSFC:
         m_BuildMap = &DistributionMapping::RRSFCProcessorMap;
         break;
+    case GRAPH:
+        m_BuildMap = &DistributionMapping::GraphProcessorMap;
+        break;
     default:
         amrex::Error("Bad DistributionMapping::Strategy");
     }
@@ -115,6 +122,8 @@ DistributionMapping::Initialize ()
     sfc_threshold    = 0;
     max_efficiency   = 0.9;
     node_size        = 0;
+    graph_ngrow      = 1;
+    graph_imbalance  = 0.03;
     flag_verbose_mapper = 0;
 
     ParmParse pp("DistributionMapping");
@@ -124,6 +133,8 @@ DistributionMapping::Initialize ()
     pp.query("efficiency",          max_efficiency);
     pp.query("sfc_threshold",       sfc_threshold);
     pp.query("node_size",           node_size);
+    pp.query("graph_ngrow",         graph_ngrow);
+    pp.query("graph_imbalance",     graph_imbalance);
     pp.query("verbose_mapper",      flag_verbose_mapper);
 
     std::string theStrategy;
@@ -146,6 +157,10 @@ DistributionMapping::Initialize ()
         {
             strategy(RRSFC);
         }
+        else if (theStrategy == "GRAPH")
+        {
+            strategy(GRAPH);
+        }
         else
         {
             std::string msg("Unknown strategy: ");
@@ -1343,6 +1358,493 @@ DistributionMapping::RRSFCProcessorMap (const BoxArray&          boxes,
     RRSFCDoIt(boxes,nprocs);
 }
 
+namespace {
+
+//
+// A graph in compressed row form, the vertices are boxes (or groups of
+// boxes on the coarser levels of the partitioner).
+//
+struct BoxGraph
+{
+    std::vector<long> vwgt;
+    std::vector<int>  xadj;   // the edges of vertex i are adj[xadj[i]:xadj[i+1]]
+    std::vector<int>  adj;
+    std::vector<long> ewgt;
+
+    int size () const { return vwgt.size(); }
+};
+
+// The subgraph on the vertices in verts, in their order.
+BoxGraph
+graph_subgraph (const BoxGraph& g, const std::vector<int>& verts)
+{
+    std::vector<int> local(g.size(), -1);
+    for (int i = 0, N = verts.size(); i < N; ++i) local[verts[i]] = i;
+
+    BoxGraph s;
+    s.xadj.push_back(0);
+    for (int v : verts) {
+        s.vwgt.push_back(g.vwgt[v]);
+        for (int e = g.xadj[v]; e < g.xadj[v+1]; ++e) {
+            if (local[g.adj[e]] >= 0) {
+                s.adj.push_back(local[g.adj[e]]);
+                s.ewgt.push_back(g.ewgt[e]);
+            }
+        }
+        s.xadj.push_back(s.adj.size());
+    }
+    return s;
+}
+
+// Heavy edge matching.  Returns the coarse graph and the map from the
+// vertices of g to those of the coarse graph.
+BoxGraph
+graph_coarsen (const BoxGraph& g, long maxvwgt, std::vector<int>& cmap)
+{
+    const int n = g.size();
+
+    // visit the vertices with few neighbors first, they have the fewest choices
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&] (int a, int b)
+                     { return g.xadj[a+1]-g.xadj[a] < g.xadj[b+1]-g.xadj[b]; });
+
+    std::vector<int> match(n, -1);
+    for (int v : order) {
+        if (match[v] >= 0) continue;
+        int best = v;
+        long bestw = -1;
+        for (int e = g.xadj[v]; e < g.xadj[v+1]; ++e) {
+            const int u = g.adj[e];
+            if (match[u] < 0 && u != v && g.ewgt[e] > bestw
+                && g.vwgt[u] + g.vwgt[v] <= maxvwgt)
+            {
+                best = u;
+                bestw = g.ewgt[e];
+            }
+        }
+        match[v] = best;
+        match[best] = v;
+    }
+
+    cmap.assign(n, -1);
+    int nc = 0;
+    for (int v = 0; v < n; ++v) {
+        if (cmap[v] < 0) {
+            cmap[v] = cmap[match[v]] = nc++;
+        }
+    }
+
+    BoxGraph c;
+    c.vwgt.assign(nc, 0);
+    c.xadj.push_back(0);
+    std::vector<int> pos(nc, -1);
+    std::vector<int> done(nc, 0);
+    for (int v = 0; v < n; ++v)
+    {
+        const int cv = cmap[v];
+        if (done[cv]) continue;
+        done[cv] = 1;
+        const int start = c.adj.size();
+        for (int w : {v, match[v]})
+        {
+            c.vwgt[cv] += g.vwgt[w];
+            for (int e = g.xadj[w]; e < g.xadj[w+1]; ++e) {
+                const int cu = cmap[g.adj[e]];
+                if (cu == cv) continue;
+                if (pos[cu] < start) {
+                    pos[cu] = c.adj.size();
+                    c.adj.push_back(cu);
+                    c.ewgt.push_back(g.ewgt[e]);
+                } else {
+                    c.ewgt[pos[cu]] += g.ewgt[e];
+                }
+            }
+            if (match[v] == v) break;
+        }
+        c.xadj.push_back(c.adj.size());
+        // vertices are numbered in the order of their first member, so the
+        // rows are filled in order
+        BL_ASSERT(static_cast<int>(c.xadj.size()) == cv+2);
+    }
+    return c;
+}
+
+// Split verts into nparts parts numbered from part0 by recursive bisection.
+// A half is grown from a seed vertex, always adding the frontier vertex that
+// is most strongly connected to it; the best of a few seeds is kept.  Each
+// half keeps at least one vertex per part if there are enough.  local is
+// scratch space of the size of g.
+void
+graph_bisect (const BoxGraph& g, const std::vector<int>& verts, int nparts, int part0,
+              std::vector<int>& part, std::vector<int>& local)
+{
+    const int n = verts.size();
+    if (nparts == 1 || n <= 1) {
+        for (int v : verts) part[v] = part0;
+        return;
+    }
+
+    for (int i = 0; i < n; ++i) local[verts[i]] = i;
+    auto in_verts = [&] (int u) -> int
+    {
+        const int i = local[u];
+        return (i >= 0 && i < n && verts[i] == u) ? i : -1;
+    };
+
+    const int nleft = nparts/2;
+    const int min_left = std::min(nleft, n-1);
+    const int max_left = std::max(min_left, n - (nparts-nleft));
+    long wtot = 0;
+    for (int v : verts) wtot += g.vwgt[v];
+    const long target = (wtot * nleft) / nparts;
+
+    std::vector<char> left(n), best_left;
+    std::vector<long> conn(n);   // edge weight into the left half
+    // (conn, -i) of the frontier vertices; an entry is stale if conn[i] has grown since
+    std::priority_queue<std::pair<long,int> > frontier;
+    long best_cut = std::numeric_limits<long>::max();
+
+    for (int seed : {0, n/3, (2*n)/3})
+    {
+        std::fill(left.begin(), left.end(), 0);
+        std::fill(conn.begin(), conn.end(), 0);
+        frontier = decltype(frontier)();
+        long wleft = 0;
+        int nl = 0;
+        int next_seed = seed;
+
+        while (nl < max_left && (wleft < target || nl < min_left))
+        {
+            while (!frontier.empty() && (left[-frontier.top().second] ||
+                                         conn[-frontier.top().second] != frontier.top().first)) {
+                frontier.pop();
+            }
+
+            int ibest = -1;
+            if (frontier.empty()) {
+                // the first seed, or a new component
+                for (int k = 0; k < n && left[next_seed]; ++k) next_seed = (next_seed+1) % n;
+                if (left[next_seed]) break;
+                ibest = next_seed;
+            } else {
+                ibest = -frontier.top().second;
+                frontier.pop();
+            }
+
+            // stop if taking the vertex overshoots more than leaving it undershoots
+            const long w = g.vwgt[verts[ibest]];
+            if (nl >= min_left && wleft > 0 && wleft + w - target > target - wleft) break;
+
+            left[ibest] = 1;
+            wleft += w;
+            ++nl;
+            const int v = verts[ibest];
+            for (int e = g.xadj[v]; e < g.xadj[v+1]; ++e) {
+                const int i = in_verts(g.adj[e]);
+                if (i < 0 || left[i]) continue;
+                conn[i] += g.ewgt[e];
+                frontier.push(std::make_pair(conn[i], -i));
+            }
+        }
+
+        long cut = 0;
+        for (int i = 0; i < n; ++i) {
+            if (!left[i]) cut += conn[i];
+        }
+        if (cut < best_cut) {
+            best_cut = cut;
+            best_left = left;
+        }
+    }
+
+    std::vector<int> vleft, vright;
+    for (int i = 0; i < n; ++i) {
+        if (best_left[i]) {
+            vleft.push_back(verts[i]);
+        } else {
+            vright.push_back(verts[i]);
+        }
+    }
+
+    graph_bisect(g, vleft,  nleft,        part0,       part, local);
+    graph_bisect(g, vright, nparts-nleft, part0+nleft, part, local);
+}
+
+// Greedy k-way refinement: move boundary vertices to the neighboring part
+// that reduces the edge cut most, as long as no part gets heavier than
+// maxpwgt, and move vertices out of parts that are too heavy.  The last
+// vertex of a part is never moved.
+void
+graph_refine (const BoxGraph& g, int nparts, long maxpwgt, std::vector<int>& part)
+{
+    const int n = g.size();
+    std::vector<long> pwgt(nparts, 0);
+    std::vector<int> pcount(nparts, 0);
+    for (int v = 0; v < n; ++v) {
+        pwgt[part[v]] += g.vwgt[v];
+        ++pcount[part[v]];
+    }
+
+    std::vector<long> conn(nparts, 0);
+    std::vector<int> nbrs;
+
+    for (int pass = 0; pass < 16; ++pass)
+    {
+        int nmoves = 0;
+        for (int v = 0; v < n; ++v)
+        {
+            const int p = part[v];
+            if (pcount[p] == 1) continue;
+            nbrs.clear();
+            for (int e = g.xadj[v]; e < g.xadj[v+1]; ++e) {
+                const int q = part[g.adj[e]];
+                if (conn[q] == 0 && q != p) nbrs.push_back(q);
+                conn[q] += g.ewgt[e];
+            }
+
+            const bool overweight = pwgt[p] > maxpwgt;
+            int best = -1;
+            long bestgain = 0;
+            for (int q : nbrs) {
+                // an overweight part may also pass vertices to a heavy but lighter
+                // neighbor, so that the excess diffuses to where there is room
+                const long wq = pwgt[q] + g.vwgt[v];
+                if (wq > maxpwgt && !(overweight && wq < pwgt[p])) continue;
+                const long gain = conn[q] - conn[p];
+                if (best < 0 || gain > bestgain || (gain == bestgain && pwgt[q] < pwgt[best])) {
+                    best = q;
+                    bestgain = gain;
+                }
+            }
+            if (best < 0 && overweight && g.xadj[v] == g.xadj[v+1]) {
+                // an isolated vertex, take it to the lightest part
+                best = static_cast<int>(std::min_element(pwgt.begin(), pwgt.end()) - pwgt.begin());
+                if (best == p || pwgt[best] + g.vwgt[v] > maxpwgt) best = -1;
+            }
+
+            for (int e = g.xadj[v]; e < g.xadj[v+1]; ++e) conn[part[g.adj[e]]] = 0;
+
+            // a move that does not change the cut has to improve the balance
+            if (best >= 0 && (bestgain > 0 || overweight ||
+                              (bestgain == 0 && pwgt[best] + g.vwgt[v] < pwgt[p])))
+            {
+                pwgt[p]    -= g.vwgt[v];
+                pwgt[best] += g.vwgt[v];
+                --pcount[p];
+                ++pcount[best];
+                part[v] = best;
+                ++nmoves;
+            }
+        }
+        if (nmoves == 0) break;
+    }
+}
+
+// Multilevel partitioning of g into nparts parts.
+std::vector<int>
+graph_partition (const BoxGraph& g, int nparts, Real imbalance)
+{
+    const int n = g.size();
+    std::vector<int> part(n, 0);
+    if (nparts <= 1 || n == 0) return part;
+
+    long wtot = 0, wmax = 0;
+    for (long w : g.vwgt) {
+        wtot += w;
+        wmax = std::max(wmax, w);
+    }
+    const long avg = (wtot + nparts - 1) / nparts;
+    const long maxpwgt = std::max(static_cast<long>(avg * (1.0 + imbalance)), wmax);
+
+
+    // coarsen until there are a few vertices per part or matching stalls
+    std::vector<BoxGraph> graphs;
+    std::vector<std::vector<int> > cmaps;
+    graphs.push_back(g);
+    while (graphs.back().size() > 8*nparts)
+    {
+        std::vector<int> cmap;
+        BoxGraph c = graph_coarsen(graphs.back(), std::max(avg/4, wmax), cmap);
+        if (c.size() > 0.9 * graphs.back().size()) break;
+        graphs.push_back(std::move(c));
+        cmaps.push_back(std::move(cmap));
+    }
+
+    const BoxGraph& gc = graphs.back();
+    std::vector<int> verts(gc.size());
+    std::iota(verts.begin(), verts.end(), 0);
+    part.assign(gc.size(), 0);
+    std::vector<int> local(gc.size(), -1);
+    graph_bisect(gc, verts, nparts, 0, part, local);
+    graph_refine(gc, nparts, maxpwgt, part);
+
+    for (int lev = cmaps.size()-1; lev >= 0; --lev)
+    {
+        const std::vector<int>& cmap = cmaps[lev];
+        std::vector<int> fpart(cmap.size());
+        for (int i = 0, N = cmap.size(); i < N; ++i) fpart[i] = part[cmap[i]];
+        part.swap(fpart);
+        graph_refine(graphs[lev], nparts, maxpwgt, part);
+    }
+
+    return part;
+}
+
+}
+
+void
+DistributionMapping::GraphProcessorMap (const BoxArray& boxes, int nprocs)
+{
+    BL_ASSERT(boxes.size() > 0);
+
+    std::vector<long> wgts;
+    wgts.reserve(boxes.size());
+    for (int i = 0, N = boxes.size(); i < N; ++i) {
+        wgts.push_back(boxes[i].numPts());
+    }
+
+    GraphProcessorMap(boxes, wgts, nprocs, graph_ngrow);
+}
+
+void
+DistributionMapping::GraphProcessorMap (const BoxArray&          boxes,
+                                        const std::vector<long>& wgts,
+                                        int                      nprocs,
+                                        int                      ngrow)
+{
+    BL_PROFILE("DistributionMapping::GraphProcessorMap()");
+
+    BL_ASSERT(boxes.size() > 0);
+    BL_ASSERT(boxes.size() == static_cast<int>(wgts.size()));
+
+    m_ref->clear();
+    m_ref->m_pmap.resize(wgts.size());
+
+    const int nboxes = boxes.size();
+
+    if (nboxes <= nprocs || nprocs == 1)
+    {
+        KnapSackProcessorMap(wgts,nprocs);
+        return;
+    }
+
+    //
+    // The graph: two boxes are neighbors if one of them grown by ngrow
+    // overlaps the other, weighted by the number of cells exchanged.
+    //
+    BoxGraph g;
+    {
+        std::vector<std::map<int,long> > nbrs(nboxes);
+        std::vector< std::pair<int,Box> > isects;
+        for (int i = 0; i < nboxes; ++i)
+        {
+            boxes.intersections(amrex::grow(boxes[i],ngrow), isects);
+            for (const auto& is : isects) {
+                const int j = is.first;
+                if (j == i) continue;
+                const long ncells = is.second.numPts();
+                nbrs[i][j] += ncells;
+                nbrs[j][i] += ncells;
+            }
+        }
+
+        g.vwgt.assign(wgts.begin(), wgts.end());
+        g.xadj.push_back(0);
+        for (int i = 0; i < nboxes; ++i) {
+            for (const auto& kv : nbrs[i]) {
+                g.adj.push_back(kv.first);
+                g.ewgt.push_back(kv.second);
+            }
+            g.xadj.push_back(g.adj.size());
+        }
+    }
+
+    //
+    // On a machine whose node IDs are known the boxes go to the nodes first,
+    // then to the processes of each node.  The two stages need the same
+    // number of processes on every node, otherwise the partition is flat.
+    //
+    std::map<int,std::vector<int> > node_ranks;
+    if (nprocs == ParallelContext::NProcsSub())
+    {
+        const Vector<int>& node_ids = machine::subgroup_node_ids();
+        for (int r = 0; r < nprocs; ++r) {
+            node_ranks[node_ids[r]].push_back(r);
+        }
+    }
+    const int nnodes = node_ranks.size();
+    const int ranks_per_node = (nnodes > 0) ? node_ranks.begin()->second.size() : 0;
+    bool two_stage = nnodes > 1 && ranks_per_node > 1;
+    for (const auto& kv : node_ranks) {
+        two_stage = two_stage && static_cast<int>(kv.second.size()) == ranks_per_node;
+    }
+
+    std::vector<int> rank(nboxes);
+    if (two_stage)
+    {
+        const std::vector<int>& node = graph_partition(g, nnodes, graph_imbalance);
+        int inode = 0;
+        for (const auto& kv : node_ranks)
+        {
+            std::vector<int> verts;
+            for (int i = 0; i < nboxes; ++i) {
+                if (node[i] == inode) verts.push_back(i);
+            }
+            ++inode;
+            if (verts.empty()) continue;
+            const BoxGraph& sg = graph_subgraph(g, verts);
+            const std::vector<int>& part = graph_partition(sg, ranks_per_node, graph_imbalance);
+            for (int i = 0, N = verts.size(); i < N; ++i) {
+                rank[verts[i]] = kv.second[part[i]];
+            }
+        }
+    }
+    else
+    {
+        rank = graph_partition(g, nprocs, graph_imbalance);
+    }
+
+    // a node with fewer boxes than processes leaves some of them without a box
+    std::vector<int> nboxes_rank(nprocs, 0);
+    for (int r : rank) ++nboxes_rank[r];
+    if (std::find(nboxes_rank.begin(), nboxes_rank.end(), 0) != nboxes_rank.end())
+    {
+        if (verbose) {
+            amrex::Print() << "GraphProcessorMap: a process has no box, using the knapsack instead\n";
+        }
+        KnapSackProcessorMap(wgts,nprocs);
+        return;
+    }
+
+    for (int i = 0; i < nboxes; ++i) {
+        m_ref->m_pmap[i] = ParallelContext::local_to_global_rank(rank[i]);
+    }
+
+    if (verbose)
+    {
+        std::vector<long> pwgt(nprocs, 0);
+        long sum_wgt = 0;
+        for (int i = 0; i < nboxes; ++i) {
+            pwgt[rank[i]] += wgts[i];
+            sum_wgt += wgts[i];
+        }
+        const long max_wgt = *std::max_element(pwgt.begin(), pwgt.end());
+
+        long ecut = 0, etot = 0;
+        for (int i = 0; i < nboxes; ++i) {
+            for (int e = g.xadj[i]; e < g.xadj[i+1]; ++e) {
+                etot += g.ewgt[e];
+                if (rank[g.adj[e]] != rank[i]) ecut += g.ewgt[e];
+            }
+        }
+
+        amrex::Print() << "Graph efficiency: " << Real(sum_wgt)/(Real(nprocs)*max_wgt)
+                       << ", ghost cells across processes: " << ecut/2
+                       << " of " << etot/2 << '\n';
+    }
+}
+
 DistributionMapping
 DistributionMapping::makeKnapSack (const Vector<Real>& rcost)
 {
@@ -1475,6 +1977,62 @@ DistributionMapping::makeSFC (const MultiFab& weight, bool sort)
     return r;
 }
 
+DistributionMapping
+DistributionMapping::makeGraph (const BoxArray& ba, const Vector<Real>& rcost, int ngrow)
+{
+    BL_PROFILE("makeGraph");
+
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(!rcost.empty() && rcost.size() == ba.size(),
+                                     "makeGraph: need one cost per box");
+
+    DistributionMapping r;
+
+    std::vector<long> cost(rcost.size());
+
+    Real wmax = *std::max_element(rcost.begin(), rcost.end());
+    Real scale = (wmax == 0) ? 1.e9 : 1.e9/wmax;
+
+    for (int i = 0; i < rcost.size(); ++i) {
+        cost[i] = long(rcost[i]*scale) + 1L;
+    }
+
+    int nprocs = ParallelContext::NProcsSub();
+
+    r.GraphProcessorMap(ba, cost, nprocs, ngrow);
+
+    return r;
+}
+
+DistributionMapping
+DistributionMapping::makeGraph (const LayoutData<Real>& cost, int ngrow)
+{
+    Vector<Real> rcost(cost.size(), 0.0);
+    for (MFIter mfi(cost); mfi.isValid(); ++mfi) {
+        rcost[mfi.index()] = cost[mfi];
+    }
+
+    ParallelAllReduce::Sum(rcost.data(), rcost.size(), ParallelContext::CommunicatorSub());
+
+    return makeGraph(cost.boxArray(), rcost, ngrow);
+}
+
+DistributionMapping
+DistributionMapping::makeGraph (const MultiFab& weight, int ngrow)
+{
+    Vector<Real> rcost(weight.size(), 0.0);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    for (MFIter mfi(weight); mfi.isValid(); ++mfi) {
+        int i = mfi.index();
+        rcost[i] = weight[mfi].sum(mfi.validbox(),0);
+    }
+
+    ParallelAllReduce::Sum(rcost.data(), rcost.size(), ParallelContext::CommunicatorSub());
+
+    return makeGraph(weight.boxArray(), rcost, ngrow);
+}
+
 std::vector<std::vector<int> >
 DistributionMapping::makeSFC (const BoxArray& ba, bool use_box_vol)
 {
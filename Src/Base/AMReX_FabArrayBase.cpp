@@ -1,4 +1,7 @@
 
+#include <algorithm>
+#include <functional>
+
 #include <AMReX_FabArrayBase.H>
 #include <AMReX_ParmParse.H>
 #include <AMReX_Utility.H>
@@ -987,6 +990,146 @@ FabArrayBase::FB::~FB ()
     delete m_RcvTags;
 }
 
+FabArrayBase::FBPlan::FBPlan (const FabArrayBase& fa, const FB& fb, int scomp, int ncomp,
+                              std::size_t value_size)
+    : m_bdkey(fa.getBDKey()),
+      m_scomp(scomp),
+      m_ncomp(ncomp),
+      m_ngrow(fb.m_ngrow),
+      m_period(fb.m_period),
+      m_cross(fb.m_cross),
+      m_comm(ParallelContext::CommunicatorSub())
+{
+    BL_PROFILE("FabArrayBase::FBPlan::FBPlan()");
+
+    // The requests live as long as the plan and keep their tag, while SeqNum
+    // wraps around; on a communicator of their own they cannot be matched by
+    // a regular FillBoundary or ParallelCopy posted in the meantime.
+#ifdef BL_USE_MPI
+    BL_MPI_REQUIRE( MPI_Comm_dup(m_comm, &m_plan_comm) );
+    const int tag = 0;
+#endif
+
+    const int myproc = ParallelDescriptor::MyProc();
+    const std::size_t cell_bytes = ncomp * value_size;
+
+    // group the tags by destination fab, keeping their order within a fab
+    auto group = [] (Vector<int>& begin, std::size_t ntags, std::function<int(int)> dst)
+        -> Vector<int>
+    {
+        const int n = ntags;
+        Vector<int> order(n);
+        for (int i = 0; i < n; ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(),
+                         [&] (int a, int b) { return dst(a) < dst(b); });
+        begin.clear();
+        for (int i = 0; i < n; ++i) {
+            if (i == 0 || dst(order[i]) != dst(order[i-1])) begin.push_back(i);
+        }
+        begin.push_back(n);
+        return order;
+    };
+
+    {
+        Vector<CopyComTag> loc;
+        for (const auto& tag : *fb.m_LocTags) {
+            if (fa.DistributionMap()[tag.dstIndex] == myproc) {
+                loc.push_back(tag);
+            }
+        }
+        auto order = group(m_loc_begin, loc.size(), [&] (int i) { return loc[i].dstIndex; });
+        for (int i : order) m_loc_tags.push_back(loc[i]);
+    }
+
+    Vector<int>         snd_rank, rcv_rank;
+    Vector<std::size_t> snd_offset, rcv_offset;
+
+    std::size_t nbytes = 0;
+    for (const auto& kv : *fb.m_SndTags)
+    {
+        snd_rank.push_back(kv.first);
+        snd_offset.push_back(nbytes);
+        for (const auto& tag : kv.second) {
+            m_snd_tags.push_back({tag.srcIndex, tag.sbox, nbytes});
+            nbytes += tag.sbox.numPts() * cell_bytes;
+        }
+    }
+    snd_offset.push_back(nbytes);
+    if (nbytes > 0) {
+        m_snd_buf = static_cast<char*>(The_Pinned_Arena()->alloc(nbytes));
+    }
+
+    nbytes = 0;
+    Vector<Tag> rcv;
+    for (const auto& kv : *fb.m_RcvTags)
+    {
+        rcv_rank.push_back(kv.first);
+        rcv_offset.push_back(nbytes);
+        for (const auto& tag : kv.second) {
+            rcv.push_back({tag.dstIndex, tag.dbox, nbytes});
+            nbytes += tag.dbox.numPts() * cell_bytes;
+        }
+    }
+    rcv_offset.push_back(nbytes);
+    if (nbytes > 0) {
+        m_rcv_buf = static_cast<char*>(The_Pinned_Arena()->alloc(nbytes));
+    }
+    {
+        auto order = group(m_rcv_begin, rcv.size(), [&] (int i) { return rcv[i].fab; });
+        for (int i : order) m_rcv_tags.push_back(rcv[i]);
+    }
+
+#ifdef BL_USE_MPI
+    for (int i = 0, N = rcv_rank.size(); i < N; ++i)
+    {
+        const std::size_t n = rcv_offset[i+1] - rcv_offset[i];
+        BL_ASSERT(n < std::numeric_limits<int>::max());
+        if (n == 0) continue;
+        MPI_Request req;
+        BL_MPI_REQUIRE( MPI_Recv_init(m_rcv_buf + rcv_offset[i], static_cast<int>(n), MPI_CHAR,
+                                      ParallelContext::global_to_local_rank(rcv_rank[i]),
+                                      tag, m_plan_comm, &req) );
+        m_rcv_reqs.push_back(req);
+    }
+    for (int i = 0, N = snd_rank.size(); i < N; ++i)
+    {
+        const std::size_t n = snd_offset[i+1] - snd_offset[i];
+        BL_ASSERT(n < std::numeric_limits<int>::max());
+        if (n == 0) continue;
+        MPI_Request req;
+        BL_MPI_REQUIRE( MPI_Send_init(m_snd_buf + snd_offset[i], static_cast<int>(n), MPI_CHAR,
+                                      ParallelContext::global_to_local_rank(snd_rank[i]),
+                                      tag, m_plan_comm, &req) );
+        m_snd_reqs.push_back(req);
+    }
+    m_stats.resize(std::max(m_snd_reqs.size(), m_rcv_reqs.size()));
+#endif
+}
+
+FabArrayBase::FBPlan::~FBPlan ()
+{
+#ifdef BL_USE_MPI
+    int finalized = 0;
+    MPI_Finalized(&finalized);
+    if (!finalized) {
+        for (auto& req : m_snd_reqs) MPI_Request_free(&req);
+        for (auto& req : m_rcv_reqs) MPI_Request_free(&req);
+        if (m_plan_comm != MPI_COMM_NULL) MPI_Comm_free(&m_plan_comm);
+    }
+#endif
+    if (m_snd_buf) The_Pinned_Arena()->free(m_snd_buf);
+    if (m_rcv_buf) The_Pinned_Arena()->free(m_rcv_buf);
+}
+
+bool
+FabArrayBase::FBPlan::matches (const FabArrayBase& fa, int scomp, int ncomp, const IntVect& nghost,
+                               const Periodicity& period, bool cross) const
+{
+    return m_bdkey == fa.getBDKey() && m_scomp == scomp && m_ncomp == ncomp
+        && m_ngrow == nghost && m_period == period && m_cross == cross
+        && m_comm == ParallelContext::CommunicatorSub();
+}
+
 void
 FabArrayBase::flushFB (bool no_assertion) const
 {
@@ -0,0 +1,302 @@
+
+#include <istream>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+#include <AMReX.H>
+#include <AMReX_FPC.H>
+#include <AMReX_FabCompress.H>
+
+namespace amrex {
+namespace FabCompress {
+
+namespace {
+
+    // the kind of a record
+    constexpr std::uint32_t Shuffled  = 0;      // the data in the written format
+    constexpr std::uint32_t Quantized = 1;      // zigzag differences of the multiples of step
+    constexpr std::uint32_t Stored    = 0x100;  // flag: the shuffled bytes are not LZ coded
+
+    constexpr int  hash_bits  = 16;
+    constexpr long min_match  = 4;
+    constexpr long max_offset = 65535;
+
+    // below 2^52 the multiples of the step are exact integers in a double
+    constexpr double max_multiple = 4.5e15;
+
+    void put_u32 (char* p, std::uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i) p[i] = static_cast<char>((v >> (8*i)) & 0xff);
+    }
+
+    void put_u64 (char* p, std::uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i) p[i] = static_cast<char>((v >> (8*i)) & 0xff);
+    }
+
+    std::uint32_t get_u32 (const char* p)
+    {
+        std::uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= std::uint32_t(static_cast<unsigned char>(p[i])) << (8*i);
+        return v;
+    }
+
+    std::uint64_t get_u64 (const char* p)
+    {
+        std::uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v |= std::uint64_t(static_cast<unsigned char>(p[i])) << (8*i);
+        return v;
+    }
+
+    std::uint32_t read32 (const unsigned char* p)
+    {
+        std::uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+
+    void corrupt ()
+    {
+        amrex::Error("FabCompress::decompress: corrupt record");
+    }
+
+    // the i-th bytes of the n items of size bytes go next to each other
+    void shuffle (const char* in, long n, int size, char* out)
+    {
+        for (int b = 0; b < size; ++b) {
+            for (long i = 0; i < n; ++i) {
+                out[b*n + i] = in[i*size + b];
+            }
+        }
+    }
+
+    void unshuffle (const char* in, long n, int size, char* out)
+    {
+        for (int b = 0; b < size; ++b) {
+            for (long i = 0; i < n; ++i) {
+                out[i*size + b] = in[b*n + i];
+            }
+        }
+    }
+
+    // the extension bytes of a length field that is 15
+    void put_length (Vector<char>& out, long len)
+    {
+        len -= 15;
+        while (len >= 255) {
+            out.push_back(static_cast<char>(255));
+            len -= 255;
+        }
+        out.push_back(static_cast<char>(len));
+    }
+
+    // literals followed by a match, or only literals if mlen == 0 (the last sequence)
+    void put_sequence (Vector<char>& out, const unsigned char* lit, long nlit, long offset, long mlen)
+    {
+        const long ml = (mlen > 0) ? mlen - min_match : 0;
+        out.push_back(static_cast<char>((std::min(nlit,15L) << 4) | std::min(ml,15L)));
+        if (nlit >= 15) put_length(out, nlit);
+        out.insert(out.end(), lit, lit + nlit);
+        if (mlen > 0) {
+            out.push_back(static_cast<char>(offset & 0xff));
+            out.push_back(static_cast<char>(offset >> 8));
+            if (ml >= 15) put_length(out, ml);
+        }
+    }
+
+    void lz_encode (const unsigned char* in, long n, Vector<char>& out)
+    {
+        std::vector<long> table(1 << hash_bits, -1);
+        long anchor = 0;
+        long ip = 0;
+        while (ip + min_match <= n)
+        {
+            const std::uint32_t seq = read32(in + ip);
+            const std::uint32_t h = (seq * 2654435761u) >> (32 - hash_bits);
+            const long ref = table[h];
+            table[h] = ip;
+            if (ref >= 0 && ip - ref <= max_offset && read32(in + ref) == seq)
+            {
+                long len = min_match;
+                while (ip + len < n && in[ref+len] == in[ip+len]) ++len;
+                put_sequence(out, in + anchor, ip - anchor, ip - ref, len);
+                ip += len;
+                anchor = ip;
+            }
+            else
+            {
+                // step faster through data that does not compress
+                ip += 1 + ((ip - anchor) >> 6);
+            }
+        }
+        put_sequence(out, in + anchor, n - anchor, 0, 0);
+    }
+
+    void lz_decode (const unsigned char* in, long nin, unsigned char* out, long nout)
+    {
+        long ip = 0, op = 0;
+        auto get_length = [&] (long len) -> long
+        {
+            if (len == 15) {
+                unsigned char c;
+                do {
+                    if (ip >= nin) corrupt();
+                    c = in[ip++];
+                    len += c;
+                } while (c == 255);
+            }
+            return len;
+        };
+
+        while (ip < nin)
+        {
+            const unsigned char token = in[ip++];
+            const long nlit = get_length(token >> 4);
+            if (ip + nlit > nin || op + nlit > nout) corrupt();
+            std::memcpy(out + op, in + ip, nlit);
+            ip += nlit;
+            op += nlit;
+            if (ip == nin) break;
+
+            if (ip + 2 > nin) corrupt();
+            const long offset = in[ip] | (long(in[ip+1]) << 8);
+            ip += 2;
+            const long mlen = get_length(token & 15) + min_match;
+            if (offset == 0 || offset > op || op + mlen > nout) corrupt();
+            const unsigned char* ref = out + op - offset;
+            if (offset >= mlen) {
+                std::memcpy(out + op, ref, mlen);
+            } else {
+                for (long i = 0; i < mlen; ++i) out[op+i] = ref[i];  // a run, the copy overlaps
+            }
+            op += mlen;
+        }
+        if (op != nout) corrupt();
+    }
+}
+
+void
+compress (const Real* src, long n, const RealDescriptor& rd, Real tol, Vector<char>& out)
+{
+    std::uint32_t kind = Shuffled;
+    int size = rd.numBytes();
+    double step = 0.0;
+    std::vector<char> data;
+
+    if (tol > 0.0)
+    {
+        step = 2.0*tol;
+        data.resize(n*8);
+        std::int64_t prev = 0;
+        long i = 0;
+        for ( ; i < n; ++i) {
+            const double x = src[i] / step;
+            if ( ! (std::abs(x) < max_multiple)) break;  // also not finite
+            const std::int64_t m = std::llround(x);
+            const std::int64_t d = m - prev;
+            prev = m;
+            const std::uint64_t z = (static_cast<std::uint64_t>(d) << 1) ^ (d < 0 ? ~std::uint64_t(0) : 0);
+            put_u64(data.data() + 8*i, z);
+        }
+        if (i == n) {
+            kind = Quantized;
+            size = 8;
+        }
+    }
+
+    if (kind == Shuffled)
+    {
+        data.resize(n*size);
+        if (rd == FPC::NativeRealDescriptor()) {
+            std::memcpy(data.data(), src, n*size);
+        } else {
+            RealDescriptor::convertFromNativeFormat(data.data(), n, src, rd);
+        }
+    }
+
+    std::vector<char> sbuf(n*size);
+    shuffle(data.data(), n, size, sbuf.data());
+
+    const long start = out.size();
+    out.resize(start + header_bytes);
+    lz_encode(reinterpret_cast<const unsigned char*>(sbuf.data()), sbuf.size(), out);
+
+    long nbytes = out.size() - start - header_bytes;
+    if (nbytes >= static_cast<long>(sbuf.size())) {
+        kind |= Stored;
+        out.resize(start + header_bytes);
+        out.insert(out.end(), sbuf.begin(), sbuf.end());
+        nbytes = sbuf.size();
+    }
+
+    char* h = out.data() + start;
+    std::uint64_t stepbits;
+    std::memcpy(&stepbits, &step, 8);
+    put_u32(h,      kind);
+    put_u32(h + 4,  size);
+    put_u64(h + 8,  nbytes);
+    put_u64(h + 16, stepbits);
+}
+
+void
+decompress (std::istream& is, Real* dst, long n, const RealDescriptor& rd)
+{
+    char h[header_bytes];
+    is.read(h, header_bytes);
+    if ( ! is.good()) corrupt();
+
+    const std::uint32_t kind   = get_u32(h);
+    const int           size   = get_u32(h + 4);
+    const long          nbytes = get_u64(h + 8);
+    const std::uint64_t stepbits = get_u64(h + 16);
+    double step;
+    std::memcpy(&step, &stepbits, 8);
+
+    const std::uint32_t base = kind & ~Stored;
+    if ((base == Quantized && size != 8) ||
+        (base == Shuffled && size != rd.numBytes()) ||
+        (base != Quantized && base != Shuffled))
+    {
+        corrupt();
+    }
+
+    std::vector<char> payload(nbytes);
+    is.read(payload.data(), nbytes);
+    if ( ! is.good()) corrupt();
+
+    std::vector<char> sbuf;
+    if (kind & Stored) {
+        if (nbytes != n*size) corrupt();
+        sbuf.swap(payload);
+    } else {
+        sbuf.resize(n*size);
+        lz_decode(reinterpret_cast<const unsigned char*>(payload.data()), nbytes,
+                  reinterpret_cast<unsigned char*>(sbuf.data()), sbuf.size());
+    }
+
+    std::vector<char> data(n*size);
+    unshuffle(sbuf.data(), n, size, data.data());
+
+    if (base == Quantized)
+    {
+        std::int64_t m = 0;
+        for (long i = 0; i < n; ++i) {
+            const std::uint64_t z = get_u64(data.data() + 8*i);
+            m += static_cast<std::int64_t>((z >> 1) ^ (~(z & 1) + 1));
+            dst[i] = static_cast<Real>(m * step);
+        }
+    }
+    else if (rd == FPC::NativeRealDescriptor())
+    {
+        std::memcpy(dst, data.data(), n*size);
+    }
+    else
+    {
+        RealDescriptor::convertToNativeFormat(dst, n, data.data(), rd);
+    }
+}
+
+}
+}
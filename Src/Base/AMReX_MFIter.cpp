@@ -2,6 +2,8 @@
 #include <AMReX_MFIter.H>
 #include <AMReX_FabArray.H>
 #include <AMReX_FArrayBox.H>
+#include <AMReX_LayoutData.H>
+#include <AMReX_Utility.H>
 
 namespace amrex {
 
@@ -130,7 +132,8 @@ MFIter::MFIter (const BoxArray& ba, const DistributionMapping& dm, const MFItInf
     local_index_map(nullptr),
     tile_array(nullptr),
     local_tile_index_map(nullptr),
-    num_local_tiles(nullptr)
+    num_local_tiles(nullptr),
+    m_cost(info.cost)
 {
 #ifdef _OPENMP
     if (dynamic) {
@@ -142,6 +145,7 @@ MFIter::MFIter (const BoxArray& ba, const DistributionMapping& dm, const MFItInf
 #endif
 
     Initialize();
+    InitializeCost();
 }
 
 MFIter::MFIter (const FabArrayBase& fabarray_, const MFItInfo& info)
@@ -158,7 +162,8 @@ MFIter::MFIter (const FabArrayBase& fabarray_, const MFItInfo& info)
     local_index_map(nullptr),
     tile_array(nullptr),
     local_tile_index_map(nullptr),
-    num_local_tiles(nullptr)
+    num_local_tiles(nullptr),
+    m_cost(info.cost)
 {
 #ifdef _OPENMP
     if (dynamic) {
@@ -170,6 +175,7 @@ MFIter::MFIter (const FabArrayBase& fabarray_, const MFItInfo& info)
 #endif
 
     Initialize();
+    InitializeCost();
 }
 
 
@@ -202,6 +208,37 @@ MFIter::~MFIter ()
 #endif
 }
 
+void
+MFIter::InitializeCost ()
+{
+    if (m_cost == nullptr) return;
+
+    BL_ASSERT(!(flags & AllBoxes));
+    BL_ASSERT(m_cost->boxArray() == fabArray.boxArray());
+    BL_ASSERT(m_cost->DistributionMap() == fabArray.DistributionMap());
+
+    m_cost_t0 = amrex::second();
+}
+
+void
+MFIter::addCost ()
+{
+#ifdef AMREX_USE_GPU
+    if (Gpu::inLaunchRegion()) {
+        Gpu::Device::synchronize();
+    }
+#endif
+
+    const Real t = amrex::second();
+    Real& c = (*m_cost)[*this];
+    // the tiles of a box may be done by several threads
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+    c += t - m_cost_t0;
+    m_cost_t0 = t;
+}
+
 void 
 MFIter::Initialize ()
 {
@@ -447,6 +484,10 @@ MFIter::grownnodaltilebox (int dir, IntVect const& a_ng) const
 void
 MFIter::operator++ ()
 {
+    if (m_cost) {
+        addCost();
+    }
+
 #ifdef _OPENMP
     int numOmpThreads = omp_get_num_threads();
 #else
@@ -688,4 +729,103 @@ MFGhostIter::Initialize ()
     tile_array      = &(lta.tileArray);
 }
 
+
+MFOverlapIter::MFOverlapIter (const FabArrayBase& fabarray, Region region, const IntVect& nghost,
+                              std::function<void()> progress, int ntest, bool do_tiling)
+    :
+    MFIter(fabarray, (unsigned char)(do_tiling ? (SkipInit|Tiling) : SkipInit)),
+    m_progress(std::move(progress)),
+    m_ntest(std::max(ntest,1))
+{
+    Initialize(region, nghost);
+}
+
+void
+MFOverlapIter::Initialize (Region region, const IntVect& nghost)
+{
+    int tid = 0;
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_num_threads();
+    if (nthreads > 1)
+	tid = omp_get_thread_num();
+#endif
+
+    // only the master thread progresses the communication, and only if MPI
+    // may be called from inside a parallel region
+    if (tid != 0 || (nthreads > 1 && !ParallelDescriptor::ThreadFunneled())) {
+        m_progress = std::function<void()>();
+    }
+
+    const IntVect ts = (flags & Tiling) ? FabArrayBase::mfiter_tile_size
+                                        : IntVect(AMREX_D_DECL(1024000,1024000,1024000));
+
+    BoxList alltiles;
+    Vector<int> allindex;
+    Vector<int> alllocalindex;
+
+    for (int i=0; i < fabArray.IndexArray().size(); ++i) {
+	int K = fabArray.IndexArray()[i];
+	const Box& vbx = amrex::enclosedCells(fabArray.box(K));
+	const Box& ibx = amrex::grow(vbx, -nghost);
+
+	BoxList pieces(vbx.ixType());
+	if (region == Inner) {
+	    if (ibx.ok()) pieces.push_back(ibx);
+	} else {
+	    pieces = ibx.ok() ? amrex::boxDiff(vbx, ibx) : BoxList(vbx);
+	}
+
+	for (BoxList::const_iterator bli = pieces.begin(); bli != pieces.end(); ++bli) {
+	    BoxList tiles(*bli, ts);
+	    int nt = tiles.size();
+	    for (int it=0; it<nt; ++it) {
+		allindex.push_back(K);
+		alllocalindex.push_back(i);
+	    }
+	    alltiles.catenate(tiles);
+	}
+    }
+
+    int n_tot_tiles = alltiles.size();
+    int navg = n_tot_tiles / nthreads;
+    int nleft = n_tot_tiles - navg*nthreads;
+    int ntiles = navg;
+    if (tid < nleft) ntiles++;
+
+    int nskip = tid*navg + std::min(tid,nleft);
+    BoxList::const_iterator bli = alltiles.begin();
+    for (int i=0; i<nskip; ++i) ++bli;
+
+    lta.indexMap.reserve(ntiles);
+    lta.localIndexMap.reserve(ntiles);
+    lta.tileArray.reserve(ntiles);
+
+    for (int i=0; i<ntiles; ++i) {
+	lta.indexMap.push_back(allindex[i+nskip]);
+	lta.localIndexMap.push_back(alllocalindex[i+nskip]);
+	lta.tileArray.push_back(*bli++);
+    }
+
+    currentIndex = beginIndex = 0;
+    endIndex = lta.indexMap.size();
+
+    lta.nuse = 0;
+    index_map       = &(lta.indexMap);
+    local_index_map = &(lta.localIndexMap);
+    tile_array      = &(lta.tileArray);
+
+    typ = fabArray.boxArray().ixType();
+}
+
+void
+MFOverlapIter::operator++ ()
+{
+    MFIter::operator++();
+
+    if (m_progress && ++m_count % m_ntest == 0) {
+        m_progress();
+    }
+}
+
 }
@@ -304,6 +304,18 @@ class Machine
 #endif
     }
 
+    // node IDs of the ranks in the current ParallelContext subgroup
+    Vector<int> subgroup_node_ids ()
+    {
+        auto sg_g_ranks = get_subgroup_ranks();
+        Vector<int> result(sg_g_ranks.size());
+        for (int i = 0; i < sg_g_ranks.size(); ++i) {
+            AMREX_ASSERT(sg_g_ranks[i] >= 0 && sg_g_ranks[i] < node_ids.size());
+            result[i] = node_ids[sg_g_ranks[i]];
+        }
+        return result;
+    }
+
   private:
 
     std::string hostname;
@@ -587,4 +599,9 @@ Vector<int> find_best_nbh (int rank_n, bool flag_local_ranks) {
     return the_machine->find_best_nbh(rank_n, flag_local_ranks);
 }
 
+Vector<int> subgroup_node_ids () {
+    AMREX_ASSERT(the_machine);
+    return the_machine->subgroup_node_ids();
+}
+
 }}
@@ -0,0 +1,382 @@
+
+#include <sstream>
+#include <streambuf>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <AMReX_MappedVisMF.H>
+#include <AMReX_FabCompress.H>
+#include <AMReX_FPC.H>
+#include <AMReX_Utility.H>
+
+namespace amrex {
+
+namespace {
+    // an istream buffer over mapped memory, for the FAB headers and the compressed records
+    struct MemBuf
+        : std::streambuf
+    {
+        MemBuf (const char* p, std::size_t n)
+        {
+            char* c = const_cast<char*>(p);
+            setg(c, c, c + n);
+        }
+        std::size_t consumed () const { return gptr() - eback(); }
+    };
+}
+
+MappedVisMF::MappedVisMF (const std::string& mf_name)
+    : m_name(mf_name)
+{
+    const std::size_t slash = mf_name.rfind('/');
+    if (slash != std::string::npos) {
+        m_dir = mf_name.substr(0, slash + 1);
+    }
+
+    Vector<char> fileCharPtr;
+    VisMF::ReadFAHeader(mf_name, fileCharPtr);
+    std::istringstream is(std::string(fileCharPtr.dataPtr()), std::istringstream::in);
+    is >> m_hdr;
+
+    m_fab.resize(m_hdr.m_ba.size());
+}
+
+MappedVisMF::~MappedVisMF ()
+{
+    clear();
+}
+
+void
+MappedVisMF::clear ()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& m : m_maps) {
+        if (m.second.second > 0) {
+            ::munmap(m.second.first, m.second.second);
+        }
+    }
+    m_maps.clear();
+    m_buffers.clear();
+    for (auto& fd : m_fab) {
+        fd = FabData();
+    }
+}
+
+const char*
+MappedVisMF::mapFile (const std::string& name)
+{
+    auto it = m_maps.find(name);
+    if (it != m_maps.end()) return it->second.first;
+
+    const int fd = ::open(name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        amrex::FileOpenFailed(name);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        amrex::FileOpenFailed(name);
+    }
+    const std::size_t n = st.st_size;
+    char* p = nullptr;
+    if (n > 0) {
+        void* m = ::mmap(nullptr, n, PROT_READ, MAP_SHARED, fd, 0);
+        if (m == MAP_FAILED) {
+            ::close(fd);
+            amrex::Error("MappedVisMF: cannot map " + name);
+        }
+        p = static_cast<char*>(m);
+    }
+    ::close(fd);
+
+    m_maps[name] = std::make_pair(p, n);
+    return p;
+}
+
+const MappedVisMF::FabData&
+MappedVisMF::locate (int idx)
+{
+    FabData& fd = m_fab[idx];
+    if (fd.located) return fd;
+
+    const std::string fileName(m_dir + m_hdr.m_fod[idx].m_name);
+    const char* p = mapFile(fileName);
+    const long fileSize = m_maps[fileName].second;
+
+    long pos = m_hdr.m_fod[idx].m_head;
+    if (pos < 0 || pos > fileSize) {
+        amrex::Error("MappedVisMF: bad offset in " + fileName);
+    }
+
+    const long npts = fabBox(idx).numPts();
+    long nbytes = 0;
+
+    if (m_hdr.m_vers == VisMF::Header::Version_v1)
+    {
+        // ---- the data follow the FAB header:  FAB RealDescriptor Box ncomp
+        MemBuf buf(p + pos, fileSize - pos);
+        std::istream is(&buf);
+        char c[4];
+        is >> c[0] >> c[1] >> c[2] >> c[3];
+        if (c[0] != 'F' || c[1] != 'A' || c[2] != 'B') {
+            amrex::Error("MappedVisMF: expected a FAB header in " + fileName);
+        }
+        if (c[3] == ':') {
+            // ---- FAB_ASCII or FAB_8BIT, left to VisMF
+            fd.binary = false;
+            fd.located = true;
+            return fd;
+        }
+        is.putback(c[3]);
+        Box bx;
+        int nvar;
+        is >> fd.rd >> bx >> nvar;
+        is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (is.fail() || bx != fabBox(idx) || nvar != m_hdr.m_ncomp) {
+            amrex::Error("MappedVisMF: bad FAB header in " + fileName);
+        }
+        pos += buf.consumed();
+        nbytes = npts * nvar * fd.rd.numBytes();
+    }
+    else if (m_hdr.m_vers == VisMF::Header::Compressed_v1)
+    {
+        fd.rd = m_hdr.m_writtenRD;
+        nbytes = FabCompress::header_bytes;
+    }
+    else
+    {
+        fd.rd = m_hdr.m_writtenRD;
+        nbytes = npts * m_hdr.m_ncomp * fd.rd.numBytes();
+    }
+
+    if (pos + nbytes > fileSize) {
+        amrex::Error("MappedVisMF: " + fileName + " is too short");
+    }
+
+    fd.data = p + pos;
+    fd.located = true;
+    return fd;
+}
+
+const MappedVisMF::FabData&
+MappedVisMF::locateBinary (int idx)
+{
+    const FabData& fd = locate(idx);
+    if ( ! fd.binary) {
+        amrex::Error("MappedVisMF: the ASCII and 8 bit FAB formats are not supported, use VisMF::Read");
+    }
+    return fd;
+}
+
+bool
+MappedVisMF::supported ()
+{
+    // ---- VisMF writes all FABs of a FabArray in the same format
+    if (m_hdr.m_vers != VisMF::Header::Version_v1 || m_fab.empty()) return true;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return locate(0).binary;
+}
+
+bool
+MappedVisMF::zeroCopy (const FabData& fd) const
+{
+    return m_hdr.m_vers != VisMF::Header::Compressed_v1
+        && fd.rd == FPC::NativeRealDescriptor()
+        && reinterpret_cast<std::uintptr_t>(fd.data) % alignof(Real) == 0;
+}
+
+bool
+MappedVisMF::isZeroCopy (int idx)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return zeroCopy(locateBinary(idx));
+}
+
+void
+MappedVisMF::decompress (int idx, Real* dst)
+{
+    const char* data;
+    RealDescriptor rd;
+    long fileSize;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const FabData& fd = locateBinary(idx);
+        data = fd.data;
+        rd = fd.rd;
+        const std::string fileName(m_dir + m_hdr.m_fod[idx].m_name);
+        fileSize = m_maps[fileName].second - (data - m_maps[fileName].first);
+    }
+    MemBuf buf(data, fileSize);
+    std::istream is(&buf);
+    FabCompress::decompress(is, dst, fabBox(idx).numPts() * m_hdr.m_ncomp, rd);
+}
+
+Array4<Real const>
+MappedVisMF::view (int idx, int comp)
+{
+    BL_ASSERT(comp >= 0 && comp < m_hdr.m_ncomp);
+
+    const Box& bx = fabBox(idx);
+    const long npts = bx.numPts();
+    const Real* p = nullptr;
+
+    if (m_hdr.m_vers == VisMF::Header::Compressed_v1)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_buffers.find(std::make_pair(idx,comp));
+            if (it != m_buffers.end()) p = it->second.dataPtr();
+        }
+        if (p == nullptr) {
+            // ---- keep all components, the whole record had to be decoded
+            Vector<Real> all(npts * m_hdr.m_ncomp);
+            decompress(idx, all.dataPtr());
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (int n = 0; n < m_hdr.m_ncomp; ++n) {
+                Vector<Real>& b = m_buffers[std::make_pair(idx,n)];
+                if (b.empty()) {
+                    b.assign(all.begin() + n*npts, all.begin() + (n+1)*npts);
+                }
+            }
+            p = m_buffers[std::make_pair(idx,comp)].dataPtr();
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const FabData& fd = locateBinary(idx);
+        if (zeroCopy(fd)) {
+            p = reinterpret_cast<const Real*>(fd.data) + comp*npts;
+        } else {
+            Vector<Real>& b = m_buffers[std::make_pair(idx,comp)];
+            if (b.empty()) {
+                b.resize(npts);
+                RealDescriptor::convertToNativeFormat(b.dataPtr(), npts,
+                                                      const_cast<char*>(fd.data + comp*npts*fd.rd.numBytes()),
+                                                      fd.rd);
+            }
+            p = b.dataPtr();
+        }
+    }
+
+    return Array4<Real const>(p, amrex::begin(bx), amrex::end(bx));
+}
+
+void
+MappedVisMF::read (FabArray<FArrayBox>& mf, int scomp, int dcomp, int ncomp)
+{
+    BL_PROFILE("MappedVisMF::read()");
+    BL_ASSERT(scomp >= 0 && scomp + ncomp <= m_hdr.m_ncomp);
+    BL_ASSERT(dcomp >= 0 && dcomp + ncomp <= mf.nComp());
+
+    const bool sameBA = (mf.boxArray() == m_hdr.m_ba);
+    const bool compressed = (m_hdr.m_vers == VisMF::Header::Compressed_v1);
+
+    auto intersect = [&] (const MFIter& mfi, std::vector<std::pair<int,Box> >& isects)
+    {
+        const Box& dbx = mf[mfi].box();
+        if (sameBA) {
+            isects.assign(1, std::make_pair(mfi.index(), dbx & fabBox(mfi.index())));
+        } else {
+            m_hdr.m_ba.intersections(dbx, isects);
+        }
+    };
+
+    // ---- a FAB on disk may overlap several of ours, decompress it only once
+    std::map<int, Vector<Real> > decoded;
+    if (compressed)
+    {
+        std::vector<std::pair<int,Box> > isects;
+        for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
+            intersect(mfi, isects);
+            for (const auto& isect : isects) {
+                if (isect.second.ok()) decoded[isect.first];
+            }
+        }
+        std::vector<std::pair<const int, Vector<Real> >*> todo;
+        for (auto& d : decoded) todo.push_back(&d);
+        const int ntodo = todo.size();
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int i = 0; i < ntodo; ++i) {
+            const int idx = todo[i]->first;
+            Vector<Real>& b = todo[i]->second;
+            b.resize(fabBox(idx).numPts() * m_hdr.m_ncomp);
+            decompress(idx, b.dataPtr());
+        }
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<std::pair<int,Box> > isects;
+
+        for (MFIter mfi(mf); mfi.isValid(); ++mfi)
+        {
+            FArrayBox& dfab = mf[mfi];
+            const Box& dbx = dfab.box();
+            intersect(mfi, isects);
+
+            for (const auto& isect : isects)
+            {
+                const int  idx = isect.first;
+                const Box& bx  = isect.second;
+                if ( ! bx.ok()) continue;
+
+                const Box& sbx = fabBox(idx);
+                const long npts = sbx.numPts();
+
+                const char* src;
+                RealDescriptor rd;
+                if (compressed) {
+                    src = reinterpret_cast<const char*>(decoded.at(idx).dataPtr());
+                    rd = FPC::NativeRealDescriptor();
+                } else {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    const FabData& fd = locateBinary(idx);
+                    src = fd.data;
+                    rd = fd.rd;
+                }
+                const bool native = (rd == FPC::NativeRealDescriptor());
+                const int nbytes = rd.numBytes();
+
+                const Dim3 lo = amrex::lbound(bx);
+                const Dim3 hi = amrex::ubound(bx);
+                const Dim3 slo = amrex::lbound(sbx);
+                const Dim3 slen = amrex::length(sbx);
+                const Dim3 dlo = amrex::lbound(dbx);
+                const Dim3 dlen = amrex::length(dbx);
+                const long nx = hi.x - lo.x + 1;
+
+                // ---- the data are copied or converted by rows
+                for (int n = 0; n < ncomp; ++n) {
+                    Real* d = dfab.dataPtr(dcomp + n);
+                    for (int k = lo.z; k <= hi.z; ++k) {
+                        for (int j = lo.y; j <= hi.y; ++j) {
+                            const long soff = (lo.x - slo.x) + (j - slo.y)*long(slen.x)
+                                + (k - slo.z)*long(slen.x)*slen.y + (scomp + n)*npts;
+                            Real* drow = d + (lo.x - dlo.x) + (j - dlo.y)*long(dlen.x)
+                                + (k - dlo.z)*long(dlen.x)*dlen.y;
+                            if (native) {
+                                std::memcpy(drow, src + soff*nbytes, nx*sizeof(Real));
+                            } else {
+                                RealDescriptor::convertToNativeFormat(drow, nx,
+                                                                      const_cast<char*>(src + soff*nbytes), rd);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+}
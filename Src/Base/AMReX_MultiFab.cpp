@@ -26,6 +26,22 @@ namespace
     int num_multifabs     = 0;
     int num_multifabs_hwm = 0;
 #endif
+
+#ifdef BL_USE_MPI
+    // the sums and maxima of MultiFabReduce in one collective: each element
+    // is a value and 1 if it is reduced as a maximum, 0 as a sum
+    MPI_Datatype mfreduce_type = MPI_DATATYPE_NULL;
+    MPI_Op       mfreduce_op   = MPI_OP_NULL;
+
+    void mfreduce_sum_max (void* invec, void* inoutvec, int* len, MPI_Datatype*)
+    {
+        const Real* in = static_cast<const Real*>(invec);
+        Real* inout = static_cast<Real*>(inoutvec);
+        for (int i = 0; i < 2*(*len); i += 2) {
+            inout[i] = (in[i+1] != 0.0) ? std::max(inout[i], in[i]) : in[i] + inout[i];
+        }
+    }
+#endif
 }
 
 Real
@@ -449,6 +465,12 @@ MultiFab::Initialize ()
 
     amrex::ExecOnFinalize(MultiFab::Finalize);
 
+#ifdef BL_USE_MPI
+    MPI_Type_contiguous(2, ParallelDescriptor::Mpi_typemap<Real>::type(), &mfreduce_type);
+    MPI_Type_commit(&mfreduce_type);
+    MPI_Op_create(mfreduce_sum_max, 1, &mfreduce_op);
+#endif
+
 #ifdef BL_MEM_PROFILING
     MemProfiler::add("MultiFab", std::function<MemProfiler::NBuildsInfo()>
 		     ([] () -> MemProfiler::NBuildsInfo {
@@ -460,6 +482,10 @@ MultiFab::Initialize ()
 void
 MultiFab::Finalize ()
 {
+#ifdef BL_USE_MPI
+    MPI_Op_free(&mfreduce_op);
+    MPI_Type_free(&mfreduce_type);
+#endif
     initialized = false;
 }
 
@@ -981,27 +1007,85 @@ MultiFab::norm2 (int comp) const
 {
     BL_ASSERT(ixType().cellCentered());
 
-    // Dot expects two MultiFabs. Make a copy to avoid aliasing.
-    MultiFab tmpmf(boxArray(), DistributionMap(), 1, 0, MFInfo(), Factory());
-    MultiFab::Copy(tmpmf, *this, comp, 0, 1, 0);
+    BL_PROFILE("MultiFab::norm2()");
+
+    Real nm2 = amrex::ReduceSum(*this, 0,
+    [=] AMREX_GPU_HOST_DEVICE (Box const& bx, FArrayBox const& fab) -> Real
+    {
+        return fab.dot(bx,comp,fab,bx,comp,1);
+    });
+
+    ParallelAllReduce::Sum(nm2, ParallelContext::CommunicatorSub());
+
+    return std::sqrt(nm2);
+}
+
+namespace {
+
+// Sum over the valid region of |x|^p / (number of boxes sharing the point),
+// p = 1 or 2.  The weights are those of MultiFab::OverlapMask, built per box
+// in a scratch fab of each thread instead of a whole MultiFab.  The weights
+// come from BoxArray intersections, so the sum is done on the host.
+Real
+WeightedNormP (const MultiFab& mf, int comp, int p, const Periodicity& period)
+{
+    const BoxArray& ba = mf.boxArray();
+    const std::vector<IntVect>& pshifts = period.shiftIntVect();
+
+    Real sm = 0.0;
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion() && !system::regtest_reduction) reduction(+:sm)
+#endif
+    {
+        FArrayBox wgt;
+        std::vector< std::pair<int,Box> > isects;
+
+        for (MFIter mfi(mf); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.validbox();
+            wgt.resize(bx, 1);
+            wgt.setVal(0.0);
+            for (const auto& iv : pshifts)
+            {
+                ba.intersections(bx+iv, isects);
+                for (const auto& is : isects)
+                {
+                    wgt.plus(1.0, is.second-iv);
+                }
+            }
+
+            const auto x = mf.array(mfi);
+            const auto w = wgt.array();
+            const Dim3 lo = amrex::lbound(bx);
+            const Dim3 hi = amrex::ubound(bx);
+            for         (int k = lo.z; k <= hi.z; ++k) {
+                for     (int j = lo.y; j <= hi.y; ++j) {
+                    for (int i = lo.x; i <= hi.x; ++i) {
+                        const Real a = std::abs(x(i,j,k,comp));
+                        sm += ((p == 1) ? a : a*a) / w(i,j,k);
+                    }
+                }
+            }
+        }
+    }
+
+    return sm;
+}
 
-    Real nm2 = MultiFab::Dot(*this, comp, tmpmf, 0, 1, 0);
-    nm2 = std::sqrt(nm2);
-    return nm2;
 }
 
 Real
 MultiFab::norm2 (int comp, const Periodicity& period) const
 {
-    MultiFab tmpmf(boxArray(), DistributionMap(), 1, 0, MFInfo(), Factory());
-    MultiFab::Copy(tmpmf, *this, comp, 0, 1, 0);
+    // cell-centered boxes do not overlap, the weights would all be one
+    if (ixType().cellCentered()) return norm2(comp);
 
-    auto mask = OverlapMask(period);
-    MultiFab::Divide(tmpmf, *mask, 0, 0, 1, 0);
+    BL_PROFILE("MultiFab::norm2(period)");
 
-    Real nm2 = MultiFab::Dot(*this, comp, tmpmf, 0, 1, 0);
-    nm2 = std::sqrt(nm2);
-    return nm2;
+    Real nm2 = WeightedNormP(*this, comp, 2, period);
+    ParallelAllReduce::Sum(nm2, ParallelContext::CommunicatorSub());
+    return std::sqrt(nm2);
 }
 
 Vector<Real>
@@ -1009,12 +1093,18 @@ MultiFab::norm2 (const Vector<int>& comps) const
 {
     BL_ASSERT(ixType().cellCentered());
 
+    MultiFabReduce r;
+    for (int comp : comps) {
+        r.addNorm2(*this, comp);
+    }
+    r.reduce();
+
     int n = comps.size();
     Vector<Real> nm2;
     nm2.reserve(n);
 
-    for (int comp : comps) {
-        nm2.push_back(this->norm2(comp));
+    for (int i = 0; i < n; ++i) {
+        nm2.push_back(r.value(i));
     }
 
     return nm2;
@@ -1023,13 +1113,13 @@ MultiFab::norm2 (const Vector<int>& comps) const
 Real
 MultiFab::norm1 (int comp, const Periodicity& period) const
 {
-    MultiFab tmpmf(boxArray(), DistributionMap(), 1, 0, MFInfo(), Factory());
-    MultiFab::Copy(tmpmf, *this, comp, 0, 1, 0);
+    if (ixType().cellCentered()) return norm1(comp, 0);
 
-    auto mask = OverlapMask(period);
-    MultiFab::Divide(tmpmf, *mask, 0, 0, 1, 0);
+    BL_PROFILE("MultiFab::norm1(period)");
 
-    return tmpmf.norm1(0, 0);
+    Real nm1 = WeightedNormP(*this, comp, 1, period);
+    ParallelAllReduce::Sum(nm1, ParallelContext::CommunicatorSub());
+    return nm1;
 }
 
 Real
@@ -1393,6 +1483,293 @@ MultiFab::OverrideSync (const iMultiFab& msk, const Periodicity& period)
     MultiFab::Copy(*this, tmpmf, 0, 0, ncomp, 0);
 }
 
+#ifdef AMREX_USE_CUDA
+namespace {
+
+// The reductions of MultiFabReduce without a MultiFab function that takes
+// ghost cells, for GPU launch regions
+Real
+MFReduceWeightedDot (const MultiFab& x, int xcomp, const MultiFab& y, int ycomp,
+                     const MultiFab& w, int numcomp, int nghost)
+{
+    return amrex::ReduceSum(x, y, w, nghost,
+    [=] AMREX_GPU_HOST_DEVICE (Box const& bx, FArrayBox const& xfab, FArrayBox const& yfab,
+                               FArrayBox const& wfab) -> Real
+    {
+        const auto len = amrex::length(bx);
+        const auto lo  = amrex::lbound(bx);
+        const auto xp  = xfab.view(lo, xcomp);
+        const auto yp  = yfab.view(lo, ycomp);
+        const auto wp  = wfab.view(lo);
+        Real r = 0.0;
+        for (int nc = 0; nc < numcomp; ++nc) {
+            for         (int k = 0; k < len.z; ++k) {
+                for     (int j = 0; j < len.y; ++j) {
+                    for (int i = 0; i < len.x; ++i) {
+                        r += xp(i,j,k,nc) * yp(i,j,k,nc) * wp(i,j,k);
+                    }
+                }
+            }
+        }
+        return r;
+    });
+}
+
+Real
+MFReduceSum (const MultiFab& x, int comp, int nghost)
+{
+    return amrex::ReduceSum(x, nghost,
+    [=] AMREX_GPU_HOST_DEVICE (Box const& bx, FArrayBox const& fab) -> Real
+    {
+        return fab.sum(bx,comp,1);
+    });
+}
+
+}
+#endif
+
+int
+MultiFabReduce::add (Kind kind, const MultiFab& x, int xcomp, const MultiFab* y, int ycomp,
+                     int numcomp, const MultiFab* w)
+{
+    BL_ASSERT(xcomp >= 0 && xcomp+numcomp <= x.nComp());
+    BL_ASSERT(m_item.empty() || x.boxArray() == m_item[0].x->boxArray());
+    BL_ASSERT(m_item.empty() || x.DistributionMap() == m_item[0].x->DistributionMap());
+    m_item.push_back(Item{kind, &x, xcomp, y, ycomp, numcomp, w});
+    return m_item.size()-1;
+}
+
+int
+MultiFabReduce::addDot (const MultiFab& x, int xcomp, const MultiFab& y, int ycomp,
+                        int numcomp, const MultiFab* weights)
+{
+    BL_ASSERT(x.boxArray() == y.boxArray());
+    BL_ASSERT(x.DistributionMap() == y.DistributionMap());
+    BL_ASSERT(ycomp >= 0 && ycomp+numcomp <= y.nComp());
+    BL_ASSERT(weights == nullptr || weights->boxArray() == x.boxArray());
+    return add(Dot, x, xcomp, &y, ycomp, numcomp, weights);
+}
+
+int MultiFabReduce::addNorm0 (const MultiFab& x, int comp, int numcomp) { return add(Norm0, x, comp, nullptr, 0, numcomp); }
+int MultiFabReduce::addNorm1 (const MultiFab& x, int comp) { return add(Norm1, x, comp, nullptr, 0); }
+int MultiFabReduce::addNorm2 (const MultiFab& x, int comp) { return add(Norm2, x, comp, nullptr, 0); }
+int MultiFabReduce::addSum   (const MultiFab& x, int comp) { return add(Sum,   x, comp, nullptr, 0); }
+int MultiFabReduce::addMin   (const MultiFab& x, int comp) { return add(Min,   x, comp, nullptr, 0); }
+int MultiFabReduce::addMax   (const MultiFab& x, int comp) { return add(Max,   x, comp, nullptr, 0); }
+
+void
+MultiFabReduce::reduce (int nghost, bool local)
+{
+    if (local) {
+        localReduce(nghost);
+        finalize();
+    } else {
+        reduceStart(nghost);
+        reduceFinish();
+    }
+}
+
+void
+MultiFabReduce::reduceStart (int nghost, MPI_Comm comm)
+{
+    BL_ASSERT(m_req == MPI_REQUEST_NULL);
+
+    localReduce(nghost);
+
+#ifdef BL_USE_MPI
+    const int n = m_item.size();
+    int nprocs = 1;
+    MPI_Comm_size(comm, &nprocs);
+    if (n > 0 && nprocs > 1)
+    {
+        m_buf.resize(2*n);
+        for (int i = 0; i < n; ++i) {
+            m_buf[2*i]   = m_value[i];
+            m_buf[2*i+1] = isMax(m_item[i].kind) ? 1.0 : 0.0;
+        }
+
+#if defined(BL_USE_MPI3)
+        BL_MPI_REQUIRE( MPI_Iallreduce(MPI_IN_PLACE, m_buf.dataPtr(), n, mfreduce_type, mfreduce_op,
+                                       comm, &m_req) );
+#else
+        // no non-blocking collectives before MPI-3, reduceFinish has nothing to wait for
+        BL_MPI_REQUIRE( MPI_Allreduce(MPI_IN_PLACE, m_buf.dataPtr(), n, mfreduce_type, mfreduce_op,
+                                      comm) );
+        for (int i = 0; i < n; ++i) {
+            m_value[i] = m_buf[2*i];
+        }
+#endif
+    }
+#else
+    amrex::ignore_unused(comm);
+#endif
+}
+
+void
+MultiFabReduce::reduceFinish ()
+{
+#ifdef BL_USE_MPI
+    if (m_req != MPI_REQUEST_NULL)
+    {
+        BL_PROFILE("MultiFabReduce::reduceFinish()");
+
+        BL_MPI_REQUIRE( MPI_Wait(&m_req, MPI_STATUS_IGNORE) );
+
+        for (int i = 0, n = m_item.size(); i < n; ++i) {
+            m_value[i] = m_buf[2*i];
+        }
+    }
+#endif
+
+    finalize();
+}
+
+void
+MultiFabReduce::localReduce (int nghost)
+{
+    BL_PROFILE("MultiFabReduce::localReduce()");
+
+    const int n = m_item.size();
+    m_value.resize(n);
+    if (n == 0) return;
+
+    // max and min are all reduced as maxima, min x = -max(-x)
+    for (int i = 0; i < n; ++i) {
+        m_value[i] = isMax(m_item[i].kind) ? std::numeric_limits<Real>::lowest() : 0.0;
+    }
+
+#ifdef AMREX_USE_CUDA
+    if (Gpu::inLaunchRegion())
+    {
+        // one device reduction per item, with the kernels of MultiFab::Dot,
+        // norm0 etc.; the parallel reduction is still shared
+        for (int i = 0; i < n; ++i)
+        {
+            const Item& item = m_item[i];
+            const MultiFab& x = *item.x;
+            switch (item.kind)
+            {
+            case Dot:
+                m_value[i] = (item.w == nullptr)
+                    ? MultiFab::Dot(x, item.xcomp, *item.y, item.ycomp, item.numcomp, nghost, true)
+                    : MFReduceWeightedDot(x, item.xcomp, *item.y, item.ycomp, *item.w,
+                                          item.numcomp, nghost);
+                break;
+            case Norm2:
+                m_value[i] = MultiFab::Dot(x, item.xcomp, x, item.xcomp, 1, nghost, true);
+                break;
+            case Norm1:
+                m_value[i] = x.norm1(item.xcomp, nghost, true);
+                break;
+            case Sum:
+                m_value[i] = MFReduceSum(x, item.xcomp, nghost);
+                break;
+            case Norm0:
+                for (int nc = 0; nc < item.numcomp; ++nc) {
+                    m_value[i] = std::max(m_value[i], x.norm0(item.xcomp+nc, nghost, true));
+                }
+                break;
+            case Min:
+                m_value[i] = -x.min(item.xcomp, nghost, true);
+                break;
+            case Max:
+                m_value[i] = x.max(item.xcomp, nghost, true);
+                break;
+            }
+        }
+        return;
+    }
+#endif
+
+    const MultiFab& mf0 = *m_item[0].x;
+#ifdef AMREX_DEBUG
+    for (const auto& item : m_item) {
+        BL_ASSERT(item.x->nGrow() >= nghost);
+        BL_ASSERT(item.y == nullptr || item.y->nGrow() >= nghost);
+        BL_ASSERT(item.w == nullptr || item.w->nGrow() >= nghost);
+    }
+#endif
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    {
+        Vector<Real> v(m_value);
+
+        for (MFIter mfi(mf0,true); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.growntilebox(nghost);
+            for (int i = 0; i < n; ++i)
+            {
+                const Item& item = m_item[i];
+                const FArrayBox& x = (*item.x)[mfi];
+                switch (item.kind)
+                {
+                case Dot:
+                    if (item.w == nullptr) {
+                        v[i] += x.dot(bx, item.xcomp, (*item.y)[mfi], bx, item.ycomp, item.numcomp);
+                    } else {
+                        const auto len = amrex::length(bx);
+                        const auto lo  = amrex::lbound(bx);
+                        const auto xp  = x.view(lo, item.xcomp);
+                        const auto yp  = (*item.y)[mfi].view(lo, item.ycomp);
+                        const auto wp  = (*item.w)[mfi].view(lo);
+                        Real r = 0.0;
+                        for (int nc = 0; nc < item.numcomp; ++nc) {
+                            for         (int k = 0; k < len.z; ++k) {
+                                for     (int j = 0; j < len.y; ++j) {
+                                    for (int ii = 0; ii < len.x; ++ii) {
+                                        r += xp(ii,j,k,nc) * yp(ii,j,k,nc) * wp(ii,j,k);
+                                    }
+                                }
+                            }
+                        }
+                        v[i] += r;
+                    }
+                    break;
+                case Norm2:
+                    v[i] += x.dot(bx, item.xcomp, x, bx, item.xcomp, 1);
+                    break;
+                case Norm1:
+                    v[i] += x.norm(bx, 1, item.xcomp, 1);
+                    break;
+                case Sum:
+                    v[i] += x.sum(bx, item.xcomp, 1);
+                    break;
+                case Norm0:
+                    v[i] = std::max(v[i], x.norm(bx, 0, item.xcomp, item.numcomp));
+                    break;
+                case Min:
+                    v[i] = std::max(v[i], -x.min(bx, item.xcomp));
+                    break;
+                case Max:
+                    v[i] = std::max(v[i], x.max(bx, item.xcomp));
+                    break;
+                }
+            }
+        }
+
+#ifdef _OPENMP
+#pragma omp critical (multifabreduce)
+#endif
+        for (int i = 0; i < n; ++i) {
+            m_value[i] = isMax(m_item[i].kind) ? std::max(m_value[i], v[i]) : m_value[i] + v[i];
+        }
+    }
+}
+
+void
+MultiFabReduce::finalize ()
+{
+    for (int i = 0, n = m_item.size(); i < n; ++i) {
+        if (m_item[i].kind == Norm2) {
+            m_value[i] = std::sqrt(m_value[i]);
+        } else if (m_item[i].kind == Min) {
+            m_value[i] = -m_value[i];
+        }
+    }
+}
+
 void
 FillBoundary (Vector<MultiFab*> const& mf, const Periodicity& period)
 {
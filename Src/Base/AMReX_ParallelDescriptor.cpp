@@ -58,6 +58,8 @@ namespace ParallelDescriptor
 
     int m_MinTag = 1000, m_MaxTag = -1;
 
+    int m_thread_funneled = false;
+
     const int ioProcessor = 0;
 
     namespace util
@@ -297,14 +299,21 @@ ParallelDescriptor::StartParallel (int*    argc,
     int sflag(0);
     MPI_Initialized(&sflag);
 
+    int provided = MPI_THREAD_SINGLE;
     if ( ! sflag) {
+#ifdef _OPENMP
+	MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
+#else
 	MPI_Init(argc, argv);
+#endif
         m_comm = MPI_COMM_WORLD;
         call_mpi_finalize = 1;
     } else {
+        MPI_Query_thread(&provided);
         MPI_Comm_dup(a_mpi_comm, &m_comm);
         call_mpi_finalize = 0;
     }
+    m_thread_funneled = provided >= MPI_THREAD_FUNNELED;
 
     ParallelContext::push(m_comm);
 
@@ -1661,6 +1670,7 @@ ParallelDescriptor::StartParallel (int*    argc,
 {
     m_comm = 0;
     m_MaxTag = 9000;
+    m_thread_funneled = true;
     ParallelContext::push(m_comm);
 }
 
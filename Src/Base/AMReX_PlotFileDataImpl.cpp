@@ -88,7 +88,7 @@ PlotFileDataImpl::PlotFileDataImpl (std::string const& plotfile_name)
         is >> relname;
         m_mf_name[ilev] = m_plotfile_name + "/" + relname;
         if (m_ncomp > 0) {
-            m_vismf[ilev].reset(new VisMF(m_mf_name[ilev]));
+            m_vismf[ilev].reset(new MappedVisMF(m_mf_name[ilev]));
             m_ba[ilev] = m_vismf[ilev]->boxArray();
             m_dmap[ilev].define(m_ba[ilev]);
             m_ngrow[ilev] = m_vismf[ilev]->nGrowVect();
@@ -132,11 +132,13 @@ PlotFileDataImpl::get (int level, std::string const& varname)
         amrex::Abort("PlotFileDataImpl::get: varname not found "+varname);
     } else {
         int icomp = std::distance(std::begin(m_var_names), r);
-        for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
-            int gid = mfi.index();
-            FArrayBox& dstfab = mf[mfi];
-            std::unique_ptr<FArrayBox> srcfab(m_vismf[level]->readFAB(gid, icomp));
-            dstfab.copy(*srcfab);
+        if (m_vismf[level]->supported()) {
+            // ---- only this component is read, from the mapped data files
+            m_vismf[level]->read(mf, icomp, 0, 1);
+        } else {
+            // ---- the ASCII and 8 bit FABs cannot be mapped, nor read by component
+            MultiFab all = get(level);
+            MultiFab::Copy(mf, all, icomp, 0, 1, m_ngrow[level]);
         }
     }
     return mf;
@@ -148,30 +148,19 @@ WriteGenericPlotfileHeader (std::ostream &HeaderFile,
 }
 
 
-void
-WriteMultiLevelPlotfile (const std::string& plotfilename, int nlevels,
-                         const Vector<const MultiFab*>& mf,
-                         const Vector<std::string>& varnames,
-                         const Vector<Geometry>& geom, Real time, const Vector<int>& level_steps,
-                         const Vector<IntVect>& ref_ratio,
-                         const std::string &versionName,
-                         const std::string &levelPrefix,
-                         const std::string &mfPrefix,
-                         const Vector<std::string>& extra_dirs)
+// the directories and the Header of a plotfile, common to the synchronous
+// and the asynchronous writes of the data
+static void
+BuildPlotfileDirsAndHeader (const std::string& plotfilename, int nlevels,
+                            const Vector<const MultiFab*>& mf,
+                            const Vector<std::string>& varnames,
+                            const Vector<Geometry>& geom, Real time, const Vector<int>& level_steps,
+                            const Vector<IntVect>& ref_ratio,
+                            const std::string &versionName,
+                            const std::string &levelPrefix,
+                            const std::string &mfPrefix,
+                            const Vector<std::string>& extra_dirs)
 {
-    BL_PROFILE("WriteMultiLevelPlotfile()");
-
-    BL_ASSERT(nlevels <= mf.size());
-    BL_ASSERT(nlevels <= geom.size());
-    BL_ASSERT(nlevels <= ref_ratio.size()+1);
-    BL_ASSERT(nlevels <= level_steps.size());
-    BL_ASSERT(mf[0]->nComp() == varnames.size());
-
-    int finest_level = nlevels-1;
-
-//    int saveNFiles(VisMF::GetNOutFiles());
-//    VisMF::SetNOutFiles(std::max(1024,saveNFiles));
-
     bool callBarrier(false);
     PreBuildDirectorHierarchy(plotfilename, levelPrefix, nlevels, callBarrier);
     if (!extra_dirs.empty()) {
@@ -202,6 +191,34 @@ WriteMultiLevelPlotfile (const std::string& plotfilename, int nlevels,
       WriteGenericPlotfileHeader(HeaderFile, nlevels, boxArrays, varnames,
                                  geom, time, level_steps, ref_ratio, versionName, levelPrefix, mfPrefix);
     }
+}
+
+void
+WriteMultiLevelPlotfile (const std::string& plotfilename, int nlevels,
+                         const Vector<const MultiFab*>& mf,
+                         const Vector<std::string>& varnames,
+                         const Vector<Geometry>& geom, Real time, const Vector<int>& level_steps,
+                         const Vector<IntVect>& ref_ratio,
+                         const std::string &versionName,
+                         const std::string &levelPrefix,
+                         const std::string &mfPrefix,
+                         const Vector<std::string>& extra_dirs)
+{
+    BL_PROFILE("WriteMultiLevelPlotfile()");
+
+    BL_ASSERT(nlevels <= mf.size());
+    BL_ASSERT(nlevels <= geom.size());
+    BL_ASSERT(nlevels <= ref_ratio.size()+1);
+    BL_ASSERT(nlevels <= level_steps.size());
+    BL_ASSERT(mf[0]->nComp() == varnames.size());
+
+    int finest_level = nlevels-1;
+
+//    int saveNFiles(VisMF::GetNOutFiles());
+//    VisMF::SetNOutFiles(std::max(1024,saveNFiles));
+
+    BuildPlotfileDirsAndHeader(plotfilename, nlevels, mf, varnames, geom, time, level_steps,
+                               ref_ratio, versionName, levelPrefix, mfPrefix, extra_dirs);
 
 
     for (int level = 0; level <= finest_level; ++level)
@@ -224,6 +241,59 @@ WriteMultiLevelPlotfile (const std::string& plotfilename, int nlevels,
 //    VisMF::SetNOutFiles(saveNFiles);
 }
 
+std::future<long>
+WriteMultiLevelPlotfileAsync (const std::string& plotfilename, int nlevels,
+                              const Vector<const MultiFab*>& mf,
+                              const Vector<std::string>& varnames,
+                              const Vector<Geometry>& geom, Real time, const Vector<int>& level_steps,
+                              const Vector<IntVect>& ref_ratio,
+                              const std::string &versionName,
+                              const std::string &levelPrefix,
+                              const std::string &mfPrefix,
+                              const Vector<std::string>& extra_dirs)
+{
+    BL_PROFILE("WriteMultiLevelPlotfileAsync()");
+
+    BL_ASSERT(nlevels <= mf.size());
+    BL_ASSERT(nlevels <= geom.size());
+    BL_ASSERT(nlevels <= ref_ratio.size()+1);
+    BL_ASSERT(nlevels <= level_steps.size());
+    BL_ASSERT(mf[0]->nComp() == varnames.size());
+
+    int finest_level = nlevels-1;
+
+    BuildPlotfileDirsAndHeader(plotfilename, nlevels, mf, varnames, geom, time, level_steps,
+                               ref_ratio, versionName, levelPrefix, mfPrefix, extra_dirs);
+
+    // ---- the data are staged by WriteAsync, mf_tmp can go right away
+    auto writes = std::make_shared<Vector<std::future<long> > >();
+    for (int level = 0; level <= finest_level; ++level)
+    {
+        const MultiFab* data;
+        std::unique_ptr<MultiFab> mf_tmp;
+        if (mf[level]->nGrow() > 0) {
+            mf_tmp.reset(new MultiFab(mf[level]->boxArray(),
+                                      mf[level]->DistributionMap(),
+                                      mf[level]->nComp(), 0, MFInfo(),
+                                      mf[level]->Factory()));
+            MultiFab::Copy(*mf_tmp, *mf[level], 0, 0, mf[level]->nComp(), 0);
+            data = mf_tmp.get();
+        } else {
+            data = mf[level];
+        }
+        writes->push_back(VisMF::WriteAsync(*data, MultiFabFileFullPrefix(level, plotfilename, levelPrefix, mfPrefix)));
+    }
+
+    return std::async(std::launch::deferred, [writes] () -> long
+    {
+        long r = 0;
+        for (auto& f : *writes) {
+            r += f.get();
+        }
+        return r;
+    });
+}
+
 // write a plotfile to disk given:
 // -plotfile name
 // -vector of MultiFabs
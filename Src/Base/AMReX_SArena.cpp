@@ -0,0 +1,348 @@
+
+#include <algorithm>
+#include <map>
+
+#include <AMReX_SArena.H>
+#include <AMReX_BLassert.H>
+#include <AMReX_Gpu.H>
+#include <AMReX.H>
+
+namespace amrex {
+
+namespace {
+    // the header in front of each block, keeps the data aligned to Arena::align_size
+    struct BlockHeader
+    {
+        std::size_t cls;
+        std::size_t size;
+    };
+    static_assert(sizeof(BlockHeader) == 16, "SArena: header must keep the alignment");
+
+    std::atomic<long> sarena_next_id{0};
+
+    // the live arenas, so that an exiting thread flushes its caches only
+    // into arenas that still exist
+    std::mutex sarena_registry_mutex;
+    std::map<long,SArena*> sarena_registry;
+    std::atomic<long> sarena_ndestroyed{0};
+}
+
+// shortcut from a thread to its cache in an arena; arena ids are never
+// reused, so a slot of a destroyed arena simply never matches again
+struct SArena::CacheSlots
+{
+    struct Slot
+    {
+        long id = -1;
+        ThreadCache* cache = nullptr;
+    };
+    static constexpr int nslots = 4;
+    std::array<Slot,nslots> slot;
+    long full_at = -1;   // sarena_ndestroyed when all slots were last found taken
+
+    ~CacheSlots ()
+    {
+        std::lock_guard<std::mutex> lock(sarena_registry_mutex);
+        for (auto& s : slot) {
+            auto it = sarena_registry.find(s.id);
+            if (it != sarena_registry.end()) {
+                it->second->release_cache(s.cache);
+            }
+        }
+    }
+};
+
+constexpr int SArena::m_nclasses;
+constexpr int SArena::m_cache_bytes;
+constexpr int SArena::m_cache_max;
+
+thread_local SArena::CacheSlots SArena::t_cache_slots;
+
+SArena::SArena (std::size_t hunk_size, ArenaInfo info)
+{
+#ifdef AMREX_USE_GPU
+    if (!info.device_use_hostalloc) {
+        amrex::Abort("SArena: the block headers are written by the host, device and managed memory are not supported");
+    }
+#endif
+    arena_info = info;
+    m_hunk = Arena::align(hunk_size == 0 ? static_cast<std::size_t>(DefaultHunkSize) : hunk_size);
+    m_id = sarena_next_id++;
+
+    std::lock_guard<std::mutex> lock(sarena_registry_mutex);
+    sarena_registry[m_id] = this;
+}
+
+SArena::~SArena ()
+{
+    {
+        std::lock_guard<std::mutex> lock(sarena_registry_mutex);
+        sarena_registry.erase(m_id);
+        ++sarena_ndestroyed;
+    }
+    for (void* p : m_alloc) {
+        deallocate_system(p);
+    }
+}
+
+int
+SArena::class_of (std::size_t total)
+{
+    if (total <= (std::size_t(1) << m_min_shift)) return 0;
+    if (total > (std::size_t(1) << m_max_shift)) return m_nclasses;
+
+    // 2^k < total <= 2^(k+1), then the sub class of width 2^(k-2)
+    int k = 0;
+#if defined(__GNUC__)
+    k = 63 - __builtin_clzll(static_cast<unsigned long long>(total-1));
+#else
+    for (std::size_t t = total-1; t > 1; t >>= 1) ++k;
+#endif
+    const std::size_t width = std::size_t(1) << (k-2);
+    const int sub = static_cast<int>((total - (std::size_t(1) << k) + width - 1) / width);
+    return (k - m_min_shift) * m_nsub + sub;
+}
+
+std::size_t
+SArena::class_size (int cls)
+{
+    if (cls == 0) return std::size_t(1) << m_min_shift;
+    const int k   = (cls - 1) / m_nsub + m_min_shift;
+    const int sub = (cls - 1) % m_nsub + 1;
+    return (std::size_t(1) << k) + sub * (std::size_t(1) << (k-2));
+}
+
+SArena::ThreadCache*
+SArena::thread_cache ()
+{
+    CacheSlots& slots = t_cache_slots;
+    for (auto& s : slots.slot) {
+        if (s.id == m_id) return s.cache;
+    }
+
+    // no slot has been freed by a destroyed arena since they were all taken
+    if (slots.full_at == sarena_ndestroyed.load()) return nullptr;
+
+    std::lock_guard<std::mutex> registry_lock(sarena_registry_mutex);
+
+    CacheSlots::Slot* slot = nullptr;
+    for (auto& s : slots.slot) {
+        if (sarena_registry.count(s.id) == 0) {
+            slot = &s;
+            break;
+        }
+    }
+    if (slot == nullptr) {
+        slots.full_at = sarena_ndestroyed.load();
+        return nullptr;
+    }
+
+    // the cache of an exited thread, or a new one
+    ThreadCache* cache = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& c : m_caches) {
+            if (!c->in_use) {
+                cache = c.get();
+                break;
+            }
+        }
+        if (cache == nullptr) {
+            m_caches.emplace_back(new ThreadCache);
+            cache = m_caches.back().get();
+        }
+        cache->in_use = true;
+    }
+
+    slot->id = m_id;
+    slot->cache = cache;
+
+    return cache;
+}
+
+void
+SArena::release_cache (ThreadCache* cache)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (int cls = 0; cls < m_nclasses; ++cls) {
+        auto& blocks = cache->blocks[cls];
+        m_free[cls].insert(m_free[cls].end(), blocks.begin(), blocks.end());
+        blocks.clear();
+    }
+    cache->in_use = false;
+}
+
+// m_mutex must be held
+void*
+SArena::alloc_block (int cls)
+{
+    auto& fl = m_free[cls];
+    if (!fl.empty()) {
+        void* p = fl.back();
+        fl.pop_back();
+        return p;
+    }
+
+    const std::size_t sz = class_size(cls);
+
+    if (sz > m_hunk/4) {
+        void* p = allocate_system(sz);
+        m_alloc.push_back(p);
+        m_used += sz;
+        return p;
+    }
+
+    if (m_hunk_left < sz)
+    {
+        // hand the rest of the old hunk out as smaller blocks
+        while (m_hunk_left >= class_size(0))
+        {
+            int c = class_of(m_hunk_left);
+            if (class_size(c) > m_hunk_left) --c;
+            m_free[c].push_back(m_hunk_ptr);
+            m_hunk_ptr  += class_size(c);
+            m_hunk_left -= class_size(c);
+        }
+
+        m_hunk_ptr = static_cast<char*>(allocate_system(m_hunk));
+        m_hunk_left = m_hunk;
+        m_alloc.push_back(m_hunk_ptr);
+        m_used += m_hunk;
+    }
+
+    void* p = m_hunk_ptr;
+    m_hunk_ptr  += sz;
+    m_hunk_left -= sz;
+    return p;
+}
+
+void*
+SArena::alloc (std::size_t nbytes)
+{
+    const std::size_t total = Arena::align(nbytes == 0 ? 1 : nbytes) + sizeof(BlockHeader);
+    const int cls = class_of(total);
+
+    ThreadCache* cache = thread_cache();
+    Counters& count = cache ? cache->count : m_shared_count;
+    count.nalloc.fetch_add(1, std::memory_order_relaxed);
+
+    BlockHeader* h = nullptr;
+
+    if (cls == m_nclasses)
+    {
+        h = static_cast<BlockHeader*>(allocate_system(total));
+        h->size = total;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_used += total;
+    }
+    else if (cache == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        h = static_cast<BlockHeader*>(alloc_block(cls));
+        h->size = class_size(cls);
+    }
+    else
+    {
+        auto& blocks = cache->blocks[cls];
+        if (!blocks.empty()) {
+            h = static_cast<BlockHeader*>(blocks.back());
+            blocks.pop_back();
+            count.nhits.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            h = static_cast<BlockHeader*>(alloc_block(cls));
+            // refill the cache with up to half of its capacity from the shared list
+            const std::size_t nrefill = std::min<std::size_t>(m_cache_max, m_cache_bytes/class_size(cls)) / 2;
+            auto& fl = m_free[cls];
+            while (blocks.size() < nrefill && !fl.empty()) {
+                blocks.push_back(fl.back());
+                fl.pop_back();
+            }
+        }
+        h->size = class_size(cls);
+    }
+
+    h->cls = cls;
+    count.bytes.fetch_add(h->size, std::memory_order_relaxed);
+
+    return h + 1;
+}
+
+void
+SArena::free (void* p)
+{
+    if (p == nullptr) return;
+
+    BlockHeader* h = static_cast<BlockHeader*>(p) - 1;
+    const int cls = static_cast<int>(h->cls);
+
+    BL_ASSERT(cls >= 0 && cls <= m_nclasses);
+
+    ThreadCache* cache = thread_cache();
+    Counters& count = cache ? cache->count : m_shared_count;
+    count.bytes.fetch_sub(h->size, std::memory_order_relaxed);
+
+    if (cls == m_nclasses)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_used -= h->size;
+        }
+        deallocate_system(h);
+        return;
+    }
+
+    if (cache == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free[cls].push_back(h);
+        return;
+    }
+
+    const std::size_t cap = std::min<std::size_t>(m_cache_max, m_cache_bytes/class_size(cls));
+    auto& blocks = cache->blocks[cls];
+    blocks.push_back(h);
+
+    if (blocks.size() > cap)
+    {
+        // give half of the cache back
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& fl = m_free[cls];
+        while (blocks.size() > cap/2) {
+            fl.push_back(blocks.back());
+            blocks.pop_back();
+        }
+    }
+}
+
+std::size_t
+SArena::heap_space_used () const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_used;
+}
+
+std::size_t
+SArena::bytes_in_use () const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    long r = m_shared_count.bytes.load(std::memory_order_relaxed);
+    for (const auto& c : m_caches) {
+        r += c->count.bytes.load(std::memory_order_relaxed);
+    }
+    return r;
+}
+
+void
+SArena::alloc_count (long& nalloc, long& ncache_hits) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    nalloc = m_shared_count.nalloc.load(std::memory_order_relaxed);
+    ncache_hits = 0;
+    for (const auto& c : m_caches) {
+        nalloc += c->count.nalloc.load(std::memory_order_relaxed);
+        ncache_hits += c->count.nhits.load(std::memory_order_relaxed);
+    }
+}
+
+}
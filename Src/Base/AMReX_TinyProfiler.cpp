@@ -6,27 +6,226 @@
 #include <iomanip>
 #include <cmath>
 #include <set>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <array>
+#include <sstream>
 
 #include <AMReX_TinyProfiler.H>
 #include <AMReX_ParallelDescriptor.H>
 #include <AMReX_ParallelReduce.H>
 #include <AMReX_Utility.H>
 #include <AMReX_Print.H>
+#include <AMReX_ParmParse.H>
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace amrex {
 
 std::vector<std::string>          TinyProfiler::regionstack;
 std::stack<std::pair<double,double> > TinyProfiler::ttstack;
 std::map<std::string,std::map<std::string, TinyProfiler::Stats> > TinyProfiler::statsmap;
 double TinyProfiler::t_init = std::numeric_limits<double>::max();
+bool TinyProfiler::tree_mode = false;
 
 namespace {
     std::set<std::string> improperly_nested_timers;
+    std::mutex improperly_nested_mutex;
     static constexpr char mainregion[] = "main";
+
+    //
+    // The call tree mode.  Each thread only touches its own ThreadData while
+    // profiling; the registry is locked when a thread or a name first appears.
+    //
+    constexpr int  nhw     = 2;       // CPU cycles and instructions
+    constexpr char pathsep = '\x1f';  // joins the names of a path in the tree
+
+    struct TreeNode
+    {
+        int id;
+        int parent;      // in the same thread, -1 for a root
+        int anchor;      // a root of a team thread: the master's node when the team began
+        long n = 0;
+        double dtin = 0.0;
+        double dtex = 0.0;
+        long long hw[nhw] = {0, 0};
+        std::vector<int> children;
+    };
+
+    struct TreeFrame
+    {
+        int node;
+        double t0;
+        double tchild;   // the inclusive time of the children
+        long long hw[nhw];
+    };
+
+    struct TraceEvent
+    {
+        int id;
+        double t0;
+        double dt;
+    };
+
+    struct ThreadData
+    {
+        int tid;
+        int perf_fd = -1;
+        std::vector<TreeNode>   nodes;
+        std::vector<int>        roots;
+        std::vector<TreeFrame>  stack;
+        std::vector<TraceEvent> events;
+
+        int child (int parent, int anchor, int id)
+        {
+            std::vector<int>& c = (parent < 0) ? roots : nodes[parent].children;
+            for (int i : c) {
+                if (nodes[i].id == id && nodes[i].anchor == anchor) return i;
+            }
+            const int i = nodes.size();
+            nodes.emplace_back();
+            nodes[i].id = id;
+            nodes[i].parent = parent;
+            nodes[i].anchor = anchor;
+            // c may have been moved by emplace_back
+            ((parent < 0) ? roots : nodes[parent].children).push_back(i);
+            return i;
+        }
+
+        void openHW ();
+
+        void readHW (long long* v) const
+        {
+#if defined(__linux__)
+            if (perf_fd >= 0) {
+                std::uint64_t buf[1+nhw];
+                if (::read(perf_fd, buf, sizeof(buf)) == static_cast<ssize_t>(sizeof(buf))) {
+                    for (int k = 0; k < nhw; ++k) v[k] = buf[1+k];
+                    return;
+                }
+            }
+#endif
+            for (int k = 0; k < nhw; ++k) v[k] = 0;
+        }
+    };
+
+    std::mutex tree_mutex;
+    std::vector<std::unique_ptr<ThreadData> > tree_threads;
+    std::vector<std::string> tree_names;
+    std::unordered_map<std::string,int> tree_ids;
+    ThreadData* main_td = nullptr;
+    std::atomic<int> main_top(-1);   // the master thread's node outside of parallel regions
+
+    thread_local ThreadData* tl_data = nullptr;
+    thread_local std::unordered_map<std::string,int> tl_ids;
+
+    bool hw_counters = false;
+    std::atomic<bool> hw_failed(false);
+    long trace_max_events = 1000000;
+    std::string json_file;
+    std::string trace_file;
+
+    void
+    ThreadData::openHW ()
+    {
+#if defined(__linux__)
+        auto open_counter = [] (std::uint64_t config, int group) -> int
+        {
+            perf_event_attr pe;
+            std::memset(&pe, 0, sizeof(pe));
+            pe.type = PERF_TYPE_HARDWARE;
+            pe.size = sizeof(pe);
+            pe.config = config;
+            pe.disabled = (group == -1);
+            pe.exclude_kernel = 1;
+            pe.exclude_hv = 1;
+            pe.read_format = PERF_FORMAT_GROUP;
+            return ::syscall(__NR_perf_event_open, &pe, 0, -1, group, 0);
+        };
+        const int leader = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1);
+        if (leader >= 0) {
+            const int member = open_counter(PERF_COUNT_HW_INSTRUCTIONS, leader);
+            if (member >= 0) {
+                ::ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                ::ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+                // the counters stay open until the process exits, the thread may still be timing
+                perf_fd = leader;
+                return;
+            }
+            ::close(leader);
+        }
+#endif
+        hw_failed = true;
+    }
+
+    ThreadData&
+    thread_data ()
+    {
+        if (tl_data == nullptr) {
+            std::lock_guard<std::mutex> lock(tree_mutex);
+            tree_threads.emplace_back(new ThreadData);
+            tl_data = tree_threads.back().get();
+            tl_data->tid = tree_threads.size() - 1;
+            if (hw_counters) tl_data->openHW();
+        }
+        return *tl_data;
+    }
+
+    // tree_mutex must be held
+    int
+    intern_locked (const std::string& name)
+    {
+        auto r = tree_ids.insert(std::make_pair(name, static_cast<int>(tree_names.size())));
+        if (r.second) tree_names.push_back(name);
+        return r.first->second;
+    }
+
+    // for the names without an id from their call site
+    int
+    intern (const std::string& name)
+    {
+        auto it = tl_ids.find(name);
+        if (it != tl_ids.end()) return it->second;
+
+        std::lock_guard<std::mutex> lock(tree_mutex);
+        const int id = intern_locked(name);
+        tl_ids[name] = id;
+        return id;
+    }
+
+    std::string
+    json_escape (const std::string& s)
+    {
+        std::string r;
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                r += '\\';
+                r += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                r += buf;
+            } else {
+                r += c;
+            }
+        }
+        return r;
+    }
 }
 
 TinyProfiler::TinyProfiler (std::string funcname)
@@ -53,6 +252,25 @@ TinyProfiler::TinyProfiler (const char* funcname, bool start_)
     if (start_) start();
 }
 
+TinyProfiler::TinyProfiler (int id, const char* funcname, bool start_)
+    : cname(funcname), tree_id(id)
+{
+    if (start_) start();
+}
+
+TinyProfiler::TinyProfiler (int id, std::string funcname, bool start_)
+    : fname(std::move(funcname)), tree_id(id)
+{
+    if (start_) start();
+}
+
+int
+TinyProfiler::Intern (const char* funcname)
+{
+    std::lock_guard<std::mutex> lock(tree_mutex);
+    return intern_locked(funcname);
+}
+
 TinyProfiler::~TinyProfiler ()
 {
     stop();
@@ -61,6 +279,11 @@ TinyProfiler::~TinyProfiler ()
 void
 TinyProfiler::start ()
 {
+    if (tree_mode) {
+        TreeStart();
+        return;
+    }
+
 #ifdef _OPENMP
 #pragma omp master
 #endif
@@ -72,12 +295,12 @@ TinyProfiler::start ()
 	global_depth = ttstack.size();
 
 #ifdef AMREX_USE_CUDA
-	nvtx_id = nvtxRangeStartA(fname.c_str());
+	nvtx_id = nvtxRangeStartA(name());
 #endif
 
         for (auto const& region : regionstack)
         {
-            Stats& st = statsmap[region][fname];
+            Stats& st = statsmap[region][name()];
             ++st.depth;
             stats.push_back(&st);
         }
@@ -87,6 +310,11 @@ TinyProfiler::start ()
 void
 TinyProfiler::stop ()
 {
+    if (tree_mode) {
+        TreeStop();
+        return;
+    }
+
 #ifdef _OPENMP
 #pragma omp master
 #endif
@@ -128,16 +356,140 @@ TinyProfiler::stop ()
 	    nvtxRangeEnd(nvtx_id);
 #endif
 	} else {
-	    improperly_nested_timers.insert(fname);
+	    improperly_nested_timers.insert(name());
 	} 
 
         stats.clear();
     }
 }
 
+bool
+TinyProfiler::InParallel ()
+{
+#ifdef _OPENMP
+    return omp_in_parallel();
+#else
+    return false;
+#endif
+}
+
+void
+TinyProfiler::TreeStart ()
+{
+    if (tree_depth > 0) return;
+#ifdef _OPENMP
+    const bool in_parallel = omp_in_parallel();
+    if (tree_master && in_parallel && omp_get_thread_num() != 0) return;
+#else
+    const bool in_parallel = false;
+#endif
+
+    ThreadData& td = thread_data();
+    if (tree_id < 0) tree_id = intern(name());
+
+    const int parent = td.stack.empty() ? -1 : td.stack.back().node;
+    const int anchor = (parent < 0 && in_parallel && &td != main_td)
+        ? main_top.load(std::memory_order_relaxed) : -1;
+    tree_node = td.child(parent, anchor, tree_id);
+
+    td.stack.emplace_back();
+    TreeFrame& f = td.stack.back();
+    f.node = tree_node;
+    f.tchild = 0.0;
+    td.readHW(f.hw);
+    tree_depth = td.stack.size();
+
+    if (&td == main_td && !in_parallel) {
+        main_top.store(tree_node, std::memory_order_relaxed);
+    }
+
+#ifdef AMREX_USE_CUDA
+    nvtx_id = nvtxRangeStartA(name());
+#endif
+
+    f.t0 = amrex::second();
+}
+
+void
+TinyProfiler::TreeStop ()
+{
+    if (tree_depth == 0) return;
+#ifdef _OPENMP
+    const bool in_parallel = omp_in_parallel();
+    if (tree_master && in_parallel && omp_get_thread_num() != 0) return;
+#else
+    const bool in_parallel = false;
+#endif
+
+    const double t = amrex::second();
+    long long hw[nhw];
+
+    ThreadData& td = thread_data();
+    td.readHW(hw);
+
+    while (static_cast<int>(td.stack.size()) > tree_depth) {
+        td.stack.pop_back();
+    }
+
+    if (static_cast<int>(td.stack.size()) == tree_depth && td.stack.back().node == tree_node)
+    {
+        const TreeFrame& f = td.stack.back();
+        const double dtin = t - f.t0;
+
+        TreeNode& node = td.nodes[tree_node];
+        ++node.n;
+        node.dtin += dtin;
+        node.dtex += dtin - f.tchild;
+        for (int k = 0; k < nhw; ++k) {
+            node.hw[k] += hw[k] - f.hw[k];
+        }
+
+        if (!trace_file.empty() && static_cast<long>(td.events.size()) < trace_max_events) {
+            td.events.push_back(TraceEvent{tree_id, f.t0, dtin});
+        }
+
+        td.stack.pop_back();
+        if (!td.stack.empty()) {
+            td.stack.back().tchild += dtin;
+        }
+
+        if (&td == main_td && !in_parallel) {
+            main_top.store(td.stack.empty() ? -1 : td.stack.back().node,
+                           std::memory_order_relaxed);
+        }
+
+#ifdef AMREX_USE_CUDA
+        nvtxRangeEnd(nvtx_id);
+#endif
+    } else {
+        std::lock_guard<std::mutex> lock(improperly_nested_mutex);
+        improperly_nested_timers.insert(name());
+    }
+
+    tree_depth = 0;
+}
+
 void
 TinyProfiler::Initialize ()
 {
+    {
+        ParmParse pp("tiny_profiler");
+        std::string mode("flat");
+        pp.query("mode", mode);
+        pp.query("json_file", json_file);
+        pp.query("trace_file", trace_file);
+        pp.query("trace_max_events", trace_max_events);
+        pp.query("hw_counters", hw_counters);
+        if (mode != "flat" && mode != "tree") {
+            amrex::Abort("TinyProfiler: unknown tiny_profiler.mode " + mode);
+        }
+        tree_mode = (mode == "tree") || !json_file.empty() || !trace_file.empty();
+    }
+
+    if (tree_mode) {
+        main_td = &thread_data();
+    }
+
     regionstack.push_back(mainregion);
     t_init = amrex::second();
 }
@@ -200,6 +552,11 @@ TinyProfiler::Finalize (bool bFlushing)
             << dt_min << " ... " << dt_avg << " ... " << dt_max << "\n";
     }
 
+    if (tree_mode) {
+        FinalizeTree(dt_max);
+        return;
+    }
+
     // make sure the set of regions is the same on all processes.
     {
         Vector<std::string> localRegions, syncedRegions;
@@ -377,6 +734,289 @@ TinyProfiler::PrintStats (std::map<std::string,Stats>& regstats, double dt_max)
     }
 }
 
+void
+TinyProfiler::FinalizeTree (double dt_max)
+{
+    // ---- the values kept for a path in the tree
+    enum { vn = 0, vinmax, vexmax, vinsum, vexsum, vthreads, vhw, nval = vhw + nhw };
+
+    std::vector<std::string> names;
+    std::vector<ThreadData*> threads;
+    {
+        std::lock_guard<std::mutex> lock(tree_mutex);
+        names = tree_names;
+        for (auto const& td : tree_threads) {
+            // the master thread first, the other threads anchor to its nodes
+            if (td.get() == main_td) {
+                threads.insert(threads.begin(), td.get());
+            } else {
+                threads.push_back(td.get());
+            }
+        }
+    }
+
+    //
+    // Merge the trees of the threads by path.  A node of a process takes the
+    // time of its slowest thread and the sum of the counters.
+    //
+    std::map<std::string, std::array<double,nval> > pathstats;
+    std::vector<std::string> mainpaths;
+    for (ThreadData* td : threads)
+    {
+        std::vector<std::string> paths(td->nodes.size());
+        for (int i = 0, N = td->nodes.size(); i < N; ++i)
+        {
+            const TreeNode& node = td->nodes[i];
+            std::string prefix;
+            if (node.parent >= 0) {
+                prefix = paths[node.parent];
+            } else if (node.anchor >= 0 && node.anchor < static_cast<int>(mainpaths.size())) {
+                prefix = mainpaths[node.anchor];
+            }
+            paths[i] = prefix.empty() ? names[node.id] : prefix + pathsep + names[node.id];
+
+            auto r = pathstats.insert(std::make_pair(paths[i], std::array<double,nval>()));
+            std::array<double,nval>& v = r.first->second;
+            if (r.second) v.fill(0.0);
+            v[vn]       += node.n;
+            v[vinmax]    = std::max(v[vinmax], node.dtin);
+            v[vexmax]    = std::max(v[vexmax], node.dtex);
+            v[vinsum]   += node.dtin;
+            v[vexsum]   += node.dtex;
+            v[vthreads] += 1.0;
+            for (int k = 0; k < nhw; ++k) {
+                v[vhw+k] += node.hw[k];
+            }
+        }
+        if (td == main_td) mainpaths = paths;
+    }
+
+    // make sure the set of paths is the same on all processes
+    {
+        Vector<std::string> localPaths, syncedPaths;
+        bool alreadySynced;
+
+        for (auto const& kv : pathstats) {
+            localPaths.push_back(kv.first);
+        }
+
+        amrex::SyncStrings(localPaths, syncedPaths, alreadySynced);
+
+        if (!alreadySynced) {
+            for (auto const& s : syncedPaths) {
+                if (pathstats.find(s) == pathstats.end()) {
+                    std::array<double,nval> v;
+                    v.fill(0.0);
+                    pathstats.insert(std::make_pair(s, v));
+                }
+            }
+        }
+    }
+
+    bool hw_ok = hw_counters && !hw_failed;
+    ParallelDescriptor::ReduceBoolAnd(hw_ok);
+
+    const int npaths = pathstats.size();
+    const int nprocs = ParallelDescriptor::NProcs();
+    const int ioproc = ParallelDescriptor::IOProcessorNumber();
+    const MPI_Comm comm = ParallelDescriptor::Communicator();
+
+    std::vector<double> vmin, vmax, vsum;
+    std::vector<std::string> paths;
+    for (auto const& kv : pathstats) {
+        paths.push_back(kv.first);
+        vmin.insert(vmin.end(), kv.second.begin(), kv.second.end());
+    }
+    vmax = vmin;
+    vsum = vmin;
+    if (npaths > 0) {
+        ParallelReduce::Min(vmin.data(), npaths*nval, ioproc, comm);
+        ParallelReduce::Max(vmax.data(), npaths*nval, ioproc, comm);
+        ParallelReduce::Sum(vsum.data(), npaths*nval, ioproc, comm);
+    }
+
+    // ---- every process writes its own trace
+    if (!trace_file.empty())
+    {
+        const std::string fname = amrex::Concatenate(trace_file + "_", ParallelDescriptor::MyProc(), 5);
+        std::ofstream ofs(fname);
+        if (!ofs.good()) amrex::FileOpenFailed(fname);
+        const int rank = ParallelDescriptor::MyProc();
+        ofs << std::setprecision(15) << "{\"traceEvents\":[";
+        bool first = true;
+        for (ThreadData* td : threads) {
+            ofs << (first ? "\n" : ",\n")
+                << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << rank
+                << ",\"tid\":" << td->tid << ",\"args\":{\"name\":\"thread " << td->tid << "\"}}";
+            first = false;
+            for (auto const& e : td->events) {
+                ofs << ",\n{\"name\":\"" << json_escape(names[e.id])
+                    << "\",\"ph\":\"X\",\"ts\":" << (e.t0 - t_init)*1.e6
+                    << ",\"dur\":" << e.dt*1.e6
+                    << ",\"pid\":" << rank << ",\"tid\":" << td->tid << "}";
+            }
+            if (static_cast<long>(td->events.size()) >= trace_max_events) {
+                amrex::AllPrint() << "TinyProfiler: the trace of thread " << td->tid << " on process "
+                                  << rank << " stopped at tiny_profiler.trace_max_events\n";
+            }
+        }
+        ofs << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+    if (!ParallelDescriptor::IOProcessor()) return;
+
+    if (hw_counters && !hw_ok) {
+        amrex::Print() << "TinyProfiler: the hardware counters are not available on all processes\n";
+    }
+
+    //
+    // Rebuild the tree from the paths, the children sorted by the inclusive time.
+    //
+    std::map<std::string,int> pathindex;
+    for (int i = 0; i < npaths; ++i) {
+        pathindex[paths[i]] = i;
+    }
+    std::vector<std::vector<int> > children(npaths);
+    std::vector<int> roots;
+    std::vector<std::string> leaf(npaths);
+    for (int i = 0; i < npaths; ++i) {
+        const std::size_t pos = paths[i].rfind(pathsep);
+        if (pos == std::string::npos) {
+            roots.push_back(i);
+            leaf[i] = paths[i];
+        } else {
+            children[pathindex[paths[i].substr(0,pos)]].push_back(i);
+            leaf[i] = paths[i].substr(pos+1);
+        }
+    }
+    auto inclusive_order = [&] (int a, int b) {
+        return vmax[a*nval+vinmax] > vmax[b*nval+vinmax];
+    };
+    std::sort(roots.begin(), roots.end(), inclusive_order);
+    for (auto& c : children) {
+        std::sort(c.begin(), c.end(), inclusive_order);
+    }
+
+    std::vector<std::pair<int,int> > order;  // (path, depth) depth first
+    {
+        std::vector<std::pair<int,int> > todo;
+        for (auto it = roots.rbegin(); it != roots.rend(); ++it) todo.push_back(std::make_pair(*it,0));
+        while (!todo.empty()) {
+            const std::pair<int,int> p = todo.back();
+            todo.pop_back();
+            order.push_back(p);
+            const auto& c = children[p.first];
+            for (auto it = c.rbegin(); it != c.rend(); ++it) todo.push_back(std::make_pair(*it,p.second+1));
+        }
+    }
+
+    int maxfnamelen = 0;
+    long maxncalls = 0;
+    for (auto const& p : order) {
+        maxfnamelen = std::max(maxfnamelen, int(2*p.second + leaf[p.first].size()));
+        maxncalls = std::max(maxncalls, long(vmax[p.first*nval+vn]));
+    }
+
+    {
+        amrex::OutStream() << std::setfill(' ') << std::setprecision(4);
+	int wt = 9;
+	int wnc = (int) std::log10 ((double) std::max(maxncalls,1L)) + 1;
+	wnc = std::max(wnc, int(std::string("NCalls").size()));
+	wt  = std::max(wt,  int(std::string("Excl. Max").size()));
+	int wp = 6;
+	wp  = std::max(wp,  int(std::string("Max %").size()));
+        const int wth = 4;
+        const int wipc = hw_ok ? 6 : 0;
+
+	const std::string hline(maxfnamelen+wnc+2+(wt+2)*5+wp+2+wth+2+(hw_ok ? wipc+2 : 0),'-');
+
+	amrex::OutStream() << "\n" << hline << "\n";
+	amrex::OutStream() << std::left
+		  << std::setw(maxfnamelen) << "Call tree"
+		  << std::right
+		  << std::setw(wnc+2) << "NCalls"
+		  << std::setw(wt+2) << "Incl. Min"
+		  << std::setw(wt+2) << "Incl. Avg"
+		  << std::setw(wt+2) << "Incl. Max"
+		  << std::setw(wt+2) << "Excl. Avg"
+		  << std::setw(wt+2) << "Excl. Max"
+		  << std::setw(wp+2) << "Max %"
+		  << std::setw(wth+2) << "Thr";
+        if (hw_ok) amrex::OutStream() << std::setw(wipc+2) << "IPC";
+        amrex::OutStream() << "\n" << hline << "\n";
+	for (auto const& p : order)
+	{
+            const int i = p.first;
+	    amrex::OutStream() << std::setprecision(4) << std::left
+		      << std::setw(maxfnamelen) << std::string(2*p.second,' ') + leaf[i]
+		      << std::right
+		      << std::setw(wnc+2) << long(vsum[i*nval+vn]/nprocs)
+		      << std::setw(wt+2) << vmin[i*nval+vinmax]
+		      << std::setw(wt+2) << vsum[i*nval+vinmax]/nprocs
+		      << std::setw(wt+2) << vmax[i*nval+vinmax]
+		      << std::setw(wt+2) << vsum[i*nval+vexmax]/nprocs
+		      << std::setw(wt+2) << vmax[i*nval+vexmax]
+		      << std::setprecision(2) << std::setw(wp+1) << std::fixed
+		      << vmax[i*nval+vinmax]*(100.0/dt_max) << "%"
+                      << std::setw(wth+2) << long(vmax[i*nval+vthreads]);
+            if (hw_ok) {
+                const double cycles = vsum[i*nval+vhw];
+                amrex::OutStream() << std::setw(wipc+2)
+                                   << (cycles > 0.0 ? vsum[i*nval+vhw+1]/cycles : 0.0);
+            }
+	    amrex::OutStream().unsetf(std::ios_base::fixed);
+	    amrex::OutStream() << "\n";
+	}
+	amrex::OutStream() << hline << "\n";
+        amrex::OutStream() << "The times of a process are those of its slowest thread; Thr is the"
+                           << " largest number of threads that made the calls.\n";
+	amrex::OutStream() << std::endl;
+    }
+
+    if (!json_file.empty())
+    {
+        std::ofstream ofs(json_file);
+        if (!ofs.good()) amrex::FileOpenFailed(json_file);
+        ofs << std::setprecision(10);
+
+        auto minavgmax = [&] (int i, int k) {
+            std::ostringstream os;
+            os << std::setprecision(10) << "{\"min\":" << vmin[i*nval+k]
+               << ",\"avg\":" << vsum[i*nval+k]/nprocs << ",\"max\":" << vmax[i*nval+k] << "}";
+            return os.str();
+        };
+
+        ofs << "{\"nprocs\":" << nprocs << ",\"total_time\":" << dt_max
+            << ",\"hw_counters\":" << (hw_ok ? "true" : "false") << ",\"tree\":[";
+        // ---- close the nodes as the depth goes down
+        int depth = -1;
+        for (std::size_t j = 0; j < order.size(); ++j)
+        {
+            const int i = order[j].first;
+            const int d = order[j].second;
+            if (d <= depth) {
+                for (int k = depth; k > d; --k) ofs << "]}";
+                ofs << "]},";
+            }
+            ofs << "\n" << std::string(2*d+2,' ')
+                << "{\"name\":\"" << json_escape(leaf[i]) << "\""
+                << ",\"ncalls\":" << minavgmax(i,vn)
+                << ",\"inclusive\":" << minavgmax(i,vinmax)
+                << ",\"exclusive\":" << minavgmax(i,vexmax)
+                << ",\"inclusive_thread_sum\":" << minavgmax(i,vinsum)
+                << ",\"exclusive_thread_sum\":" << minavgmax(i,vexsum)
+                << ",\"threads\":" << minavgmax(i,vthreads);
+            if (hw_ok) {
+                ofs << ",\"cycles\":" << vsum[i*nval+vhw] << ",\"instructions\":" << vsum[i*nval+vhw+1];
+            }
+            ofs << ",\"children\":[";
+            depth = d;
+        }
+        for (int k = depth; k >= 0; --k) ofs << "]}";
+        ofs << "\n]}\n";
+    }
+}
+
 void
 TinyProfiler::StartRegion (std::string regname)
 {
@@ -5,6 +5,10 @@
 #include <sstream>
 #include <vector>
 #include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <cerrno>
 
 #include <AMReX_ccse-mpi.H>
@@ -12,7 +16,9 @@
 #include <AMReX_VisMF.H>
 #include <AMReX_ParmParse.H>
 #include <AMReX_NFiles.H>
+#include <AMReX_ParallelReduce.H>
 #include <AMReX_FPC.H>
+#include <AMReX_FabCompress.H>
 
 namespace amrex {
 
@@ -33,6 +39,7 @@ bool VisMF::usePersistentIFStreams(false);
 bool VisMF::useSynchronousReads(false);
 bool VisMF::useDynamicSetSelection(true);
 bool VisMF::allowSparseWrites(true);
+Real VisMF::compressionTol(0.0);
 
 long VisMF::ioBufferSize(VisMF::IO_Buffer_Size);
 
@@ -46,6 +53,81 @@ int VisMF::nMFFileInStreams(4);
 namespace
 {
     bool initialized = false;
+
+    //
+    // The result of a write of VisMF::WriteAsync, the error is reported by
+    // the thread that waits on the write.
+    //
+    struct AsyncResult
+    {
+        long bytes = 0;
+        std::string error;
+    };
+
+    //
+    // The thread of VisMF::WriteAsync.  The staged buffers are written one
+    // at a time in the order they were queued, so that many small writes do
+    // not start a thread each and compete for the file system.  The thread
+    // is started with the first write and joined, after the queued writes
+    // are done, in VisMF::Finalize.
+    //
+    class AsyncWriter
+    {
+    public:
+        AsyncWriter () : m_thread([this] () { run(); }) {}
+
+        ~AsyncWriter ()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_cv.notify_one();
+            m_thread.join();
+        }
+
+        template <class F>
+        std::future<AsyncResult> push (F&& f)
+        {
+            std::packaged_task<AsyncResult()> task(std::forward<F>(f));
+            std::future<AsyncResult> r = task.get_future();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.push_back(std::move(task));
+            }
+            m_cv.notify_one();
+            return r;
+        }
+
+    private:
+        void run ()
+        {
+            for (;;)
+            {
+                std::packaged_task<AsyncResult()> task;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_cv.wait(lock, [this] () { return m_stop || !m_queue.empty(); });
+                    if (m_queue.empty()) return;
+                    task = std::move(m_queue.front());
+                    m_queue.pop_front();
+                }
+                task();
+            }
+        }
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::deque<std::packaged_task<AsyncResult()> > m_queue;
+        bool m_stop = false;
+        std::thread m_thread;   // last, it uses the members above
+    };
+
+    std::unique_ptr<AsyncWriter> async_writer;
+
+    // the first error of the I/O thread, raised by VisMF::Finalize if no one waited on it
+    std::mutex async_error_mutex;
+    std::string async_error;
 }
 
 void
@@ -72,6 +154,9 @@ VisMF::Initialize ()
       currentVersion = static_cast<VisMF::Header::Version> (headerVersion);
     }
 
+    if(pp.query("noutfiles", nOutFiles)) {
+      VisMF::SetNOutFiles(nOutFiles);
+    }
     pp.query("groupsets", groupSets);
     pp.query("setbuf", setBuf);
     pp.query("usesingleread", useSingleRead);
@@ -82,6 +167,7 @@ VisMF::Initialize ()
     pp.query("usedynamicsetselection", useDynamicSetSelection);
     pp.query("iobuffersize", ioBufferSize);
     pp.query("allowsparsewrites", allowSparseWrites);
+    pp.query("compressiontol", compressionTol);
 
     initialized = true;
 }
@@ -89,7 +175,11 @@ VisMF::Initialize ()
 void
 VisMF::Finalize ()
 {
+    async_writer.reset();
     initialized = false;
+    if( ! async_error.empty()) {
+      amrex::Error(async_error);
+    }
 }
 
 void
@@ -282,7 +372,8 @@ operator<< (std::ostream        &os,
     os << hd.m_fod      << '\n';
 
     if(hd.m_vers == VisMF::Header::Version_v1 ||
-       hd.m_vers == VisMF::Header::NoFabHeaderMinMax_v1)
+       hd.m_vers == VisMF::Header::NoFabHeaderMinMax_v1 ||
+       hd.m_vers == VisMF::Header::Compressed_v1)
     {
       os << hd.m_min      << '\n';
       os << hd.m_max      << '\n';
@@ -303,7 +394,8 @@ operator<< (std::ostream        &os,
 
     if(hd.m_vers == VisMF::Header::NoFabHeader_v1       ||
        hd.m_vers == VisMF::Header::NoFabHeaderMinMax_v1 ||
-       hd.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1)
+       hd.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1 ||
+       hd.m_vers == VisMF::Header::Compressed_v1)
     {
       if(FArrayBox::getFormat() == FABio::FAB_NATIVE) {
         os << FPC::NativeRealDescriptor() << '\n';
@@ -314,6 +406,10 @@ operator<< (std::ostream        &os,
       }
     }
 
+    if(hd.m_vers == VisMF::Header::Compressed_v1) {
+      os << hd.m_tol << '\n';
+    }
+
     os.flags(oflags);
     os.precision(oldPrec);
 
@@ -366,7 +462,8 @@ operator>> (std::istream  &is,
     BL_ASSERT(hd.m_ba.size() == hd.m_fod.size());
 
     if(hd.m_vers == VisMF::Header::Version_v1 ||
-       hd.m_vers == VisMF::Header::NoFabHeaderMinMax_v1)
+       hd.m_vers == VisMF::Header::NoFabHeaderMinMax_v1 ||
+       hd.m_vers == VisMF::Header::Compressed_v1)
     {
       is >> hd.m_min;
       is >> hd.m_max;
@@ -393,10 +490,14 @@ operator>> (std::istream  &is,
     }
     if(hd.m_vers == VisMF::Header::NoFabHeader_v1       ||
        hd.m_vers == VisMF::Header::NoFabHeaderMinMax_v1 ||
-       hd.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1)
+       hd.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1 ||
+       hd.m_vers == VisMF::Header::Compressed_v1)
     {
       is >> hd.m_writtenRD;
     }
+    if(hd.m_vers == VisMF::Header::Compressed_v1) {
+      is >> hd.m_tol;
+    }
 
 
     if( ! is.good()) {
@@ -941,6 +1042,10 @@ VisMF::Write (const FabArray<FArrayBox>&    mf,
         }
     }
 
+    // ---- compressed fabs have sizes known only to their proc, the offsets are
+    // ---- gathered after writing with the static file assignment
+    bool compressed(currentVersion == VisMF::Header::Compressed_v1);
+
     // ---- check if mf has sparse data
     bool useSparseFPP(false);
     const Vector<int> &pmap = mf.DistributionMap().ProcessorMap();
@@ -949,7 +1054,7 @@ VisMF::Write (const FabArray<FArrayBox>&    mf,
     for(int i(0); i < pmap.size(); ++i) {
       procsWithData.insert(pmap[i]);
     }
-    if(allowSparseWrites && (procsWithData.size() < nOutFiles)) {
+    if(allowSparseWrites && ! compressed && (procsWithData.size() < static_cast<std::size_t>(nOutFiles))) {
       useSparseFPP = true;
 //      amrex::Print() << "SSSSSSSS:  in VisMF::Write:  useSparseFPP for:  " << mf_name << '\n';
       for(std::set<int>::iterator it = procsWithData.begin(); it != procsWithData.end(); ++it) {
@@ -968,12 +1073,39 @@ VisMF::Write (const FabArray<FArrayBox>&    mf,
 
     bool oldHeader(currentVersion == VisMF::Header::Version_v1);
 
+    // ---- compress before waiting for the turn to write
+    Vector<Vector<char> > compressedFabs;
+    if(compressed) {
+      hdr.m_tol = compressionTol;
+      compressedFabs.resize(mf.local_size());
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      for(MFIter mfi(mf); mfi.isValid(); ++mfi) {
+        const FArrayBox &fab = mf[mfi];
+        FabCompress::compress(fab.dataPtr(), fab.box().numPts() * mf.nComp(), *whichRD,
+                              compressionTol, compressedFabs[mf.localindex(mfi.index())]);
+      }
+    }
+
       if(useSparseFPP) {
         nfi.SetSparseFPP(procsWithDataVector);
-      } else if(useDynamicSetSelection) {
+      } else if(useDynamicSetSelection && ! compressed) {
         nfi.SetDynamic();
       }
       for( ; nfi.ReadyToWrite(); ++nfi) {
+          if(compressed) {
+            for(MFIter mfi(mf); mfi.isValid(); ++mfi) {
+              const Vector<char> &cfab = compressedFabs[mf.localindex(mfi.index())];
+              hdr.m_fod[mfi.index()].m_name = VisMF::BaseName(nfi.FileName());
+              hdr.m_fod[mfi.index()].m_head = VisMF::FileOffset(nfi.Stream());
+              nfi.Stream().write(cfab.dataPtr(), cfab.size());
+              bytesWritten += cfab.size();
+            }
+            nfi.Stream().flush();
+            continue;
+          }
+
 	  // ---- find the total number of bytes including fab headers if needed
           const FABio &fio = FArrayBox::getFABio();
           int whichRDBytes(whichRD->numBytes()), nFABs(0);
@@ -1061,7 +1193,8 @@ VisMF::Write (const FabArray<FArrayBox>&    mf,
     }
 
     if(currentVersion == VisMF::Header::Version_v1 ||
-       currentVersion == VisMF::Header::NoFabHeaderMinMax_v1)
+       currentVersion == VisMF::Header::NoFabHeaderMinMax_v1 ||
+       currentVersion == VisMF::Header::Compressed_v1)
     {
       hdr.CalculateMinMax(mf, coordinatorProc);
     }
@@ -1110,6 +1243,192 @@ VisMF::WriteOnlyHeader (const FabArray<FArrayBox> & mf,
 }
 
 
+std::future<long>
+VisMF::WriteAsync (const FabArray<FArrayBox>& mf,
+                   const std::string& mf_name)
+{
+    BL_PROFILE("VisMF::WriteAsync(FabArray)");
+    BL_ASSERT(mf_name[mf_name.length() - 1] != '/');
+    BL_ASSERT(currentVersion != VisMF::Header::Undefined_v1);
+
+    RealDescriptor *whichRD;
+    if(FArrayBox::getFormat() == FABio::FAB_NATIVE) {
+      whichRD = FPC::NativeRealDescriptor().clone();
+    } else if(FArrayBox::getFormat() == FABio::FAB_NATIVE_32) {
+      whichRD = FPC::Native32RealDescriptor().clone();
+    } else if(FArrayBox::getFormat() == FABio::FAB_IEEE_32) {
+      whichRD = FPC::Ieee32NormalRealDescriptor().clone();
+    }
+    bool doConvert(*whichRD != FPC::NativeRealDescriptor());
+    int whichRDBytes(whichRD->numBytes());
+
+    const int myProc(ParallelDescriptor::MyProc());
+    int coordinatorProc(ParallelDescriptor::IOProcessorNumber());
+    bool calcMinMax(false);
+    VisMF::Header hdr(mf, VisMF::NFiles, currentVersion, calcMinMax);
+
+    std::string filePrefix(mf_name + FabFileSuffix);
+    bool oldHeader(currentVersion == VisMF::Header::Version_v1);
+    const FABio &fio = FArrayBox::getFABio();
+
+    auto allFabData = std::make_shared<Vector<char> >();
+    Vector<long> offsets(mf.size(), 0L);
+
+    if(currentVersion == VisMF::Header::Compressed_v1) {
+      // ---- stage the compressed fabs of this proc
+      hdr.m_tol = compressionTol;
+      Vector<Vector<char> > compressedFabs(mf.local_size());
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      for(MFIter mfi(mf); mfi.isValid(); ++mfi) {
+        const FArrayBox &fab = mf[mfi];
+        FabCompress::compress(fab.dataPtr(), fab.box().numPts() * mf.nComp(), *whichRD,
+                              compressionTol, compressedFabs[mf.localindex(mfi.index())]);
+      }
+      for(MFIter mfi(mf); mfi.isValid(); ++mfi) {
+        const Vector<char> &cfab = compressedFabs[mf.localindex(mfi.index())];
+        offsets[mfi.index()] = allFabData->size();
+        allFabData->insert(allFabData->end(), cfab.begin(), cfab.end());
+      }
+    } else {
+      // ---- stage the fabs of this proc, with the fab headers if needed
+      long bytesToWrite(0);
+      for(MFIter mfi(mf); mfi.isValid(); ++mfi) {
+        const FArrayBox &fab = mf[mfi];
+        if(oldHeader) {
+          std::stringstream hss;
+          fio.write_header(hss, fab, fab.nComp());
+          bytesToWrite += static_cast<std::streamoff>(hss.tellp());
+        }
+        bytesToWrite += fab.box().numPts() * mf.nComp() * whichRDBytes;
+      }
+
+      allFabData->resize(bytesToWrite);
+      long writePosition(0);
+      for(MFIter mfi(mf); mfi.isValid(); ++mfi) {
+        int hLength(0);
+        const FArrayBox &fab = mf[mfi];
+        long writeDataItems(fab.box().numPts() * mf.nComp());
+        long writeDataSize(writeDataItems * whichRDBytes);
+        char *afPtr = allFabData->dataPtr() + writePosition;
+        offsets[mfi.index()] = writePosition;
+        if(oldHeader) {
+          std::stringstream hss;
+          fio.write_header(hss, fab, fab.nComp());
+          hLength = static_cast<std::streamoff>(hss.tellp());
+          memcpy(afPtr, hss.str().c_str(), hLength);  // ---- the fab header
+        }
+        if(doConvert) {
+          RealDescriptor::convertFromNativeFormat(static_cast<void *> (afPtr + hLength),
+                                                  writeDataItems,
+                                                  fab.dataPtr(), *whichRD);
+        } else {    // ---- copy from the fab
+          memcpy(afPtr + hLength, fab.dataPtr(), writeDataSize);
+        }
+        writePosition += hLength + writeDataSize;
+      }
+    }
+    delete whichRD;
+
+    // ---- the files and their order are those of NFilesIter with static sets:
+    // ---- the data of a proc follow those of the procs before it in its set
+    const int nProcs(ParallelDescriptor::NProcs());
+    const int nOutFilesActual(NFilesIter::ActualNFiles(nOutFiles));
+    const int myFileNumber(NFilesIter::FileNumber(nOutFilesActual, myProc, groupSets));
+    const int mySetPosition(NFilesIter::WhichSetPosition(myProc, nProcs, nOutFilesActual, groupSets));
+    const std::string fileName(NFilesIter::FileName(myFileNumber, filePrefix));
+
+    if(mySetPosition == 0) {
+      // ---- the file is created before the sizes are gathered, so before any proc writes to it
+      std::ofstream ofs(fileName.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+      if( ! ofs.good()) {
+        amrex::FileOpenFailed(fileName);
+      }
+    }
+
+    const long myBytes(allFabData->size());
+    Vector<long> procBytes(nProcs, 0L);
+    procBytes[myProc] = myBytes;
+    ParallelAllGather::AllGather(myBytes, procBytes.dataPtr(), ParallelDescriptor::Communicator());
+
+    long fileOffset(0);
+    for(int iProc(0); iProc < nProcs; ++iProc) {
+      if(NFilesIter::FileNumber(nOutFilesActual, iProc, groupSets) == myFileNumber &&
+         NFilesIter::WhichSetPosition(iProc, nProcs, nOutFilesActual, groupSets) < mySetPosition)
+      {
+        fileOffset += procBytes[iProc];
+      }
+    }
+    for(MFIter mfi(mf); mfi.isValid(); ++mfi) {
+      offsets[mfi.index()] += fileOffset;
+    }
+
+    ParallelDescriptor::ReduceLongSum(offsets.dataPtr(), offsets.size(), coordinatorProc);
+    if(myProc == coordinatorProc) {
+      const Vector<int> &pmap = mf.DistributionMap().ProcessorMap();
+      for(int i(0), N(mf.size()); i < N; ++i) {
+        hdr.m_fod[i].m_head = offsets[i];
+        hdr.m_fod[i].m_name = VisMF::BaseName(NFilesIter::FileName(nOutFilesActual, filePrefix,
+                                                                    pmap[i], groupSets));
+      }
+    }
+
+    if(currentVersion == VisMF::Header::Version_v1 ||
+       currentVersion == VisMF::Header::NoFabHeaderMinMax_v1 ||
+       currentVersion == VisMF::Header::Compressed_v1)
+    {
+      hdr.CalculateMinMax(mf, coordinatorProc);
+    }
+
+    long bytesWritten = VisMF::WriteHeader(mf_name, hdr, coordinatorProc);
+
+    if( ! async_writer) {
+      async_writer.reset(new AsyncWriter);
+    }
+
+    // ---- no MPI calls and no amrex::Error on the I/O thread
+    std::future<AsyncResult> w = async_writer->push([allFabData, fileName, fileOffset, bytesWritten] ()
+    {
+        AsyncResult r;
+        r.bytes = bytesWritten;
+        if(allFabData->empty()) {
+          return r;
+        }
+        std::fstream fs(fileName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+        if( ! fs.good()) {
+          r.error = "VisMF::WriteAsync:  couldn't open file: " + fileName;
+        } else {
+          fs.seekp(fileOffset, std::ios::beg);
+          fs.write(allFabData->dataPtr(), allFabData->size());
+          fs.close();
+          if( ! fs.good()) {
+            r.error = "VisMF::WriteAsync:  error writing " + fileName;
+          }
+        }
+        if(r.error.empty()) {
+          r.bytes += static_cast<long>(allFabData->size());
+        } else {
+          std::lock_guard<std::mutex> lock(async_error_mutex);
+          if(async_error.empty()) {
+            async_error = r.error;
+          }
+        }
+        return r;
+    });
+
+    // ---- the error is raised by the thread that waits on the write
+    return std::async(std::launch::deferred, [w = std::move(w)] () mutable -> long
+    {
+        AsyncResult r = w.get();
+        if( ! r.error.empty()) {
+          amrex::Error(r.error);
+        }
+        return r.bytes;
+    });
+}
+
+
 void
 VisMF::FindOffsets (const FabArray<FArrayBox> &mf,
 		    const std::string &filePrefix,
@@ -1128,7 +1447,8 @@ VisMF::FindOffsets (const FabArray<FArrayBox> &mf,
     }
 
     if(FArrayBox::getFormat() == FABio::FAB_ASCII ||
-       FArrayBox::getFormat() == FABio::FAB_8BIT)
+       FArrayBox::getFormat() == FABio::FAB_8BIT  ||
+       whichVersion == VisMF::Header::Compressed_v1)
     {
 
 #ifdef BL_USE_MPI
@@ -1361,7 +1681,17 @@ VisMF::readFAB (int                  idx,
     std::ifstream *infs = VisMF::OpenStream(FullName);
     infs->seekg(hdr.m_fod[idx].m_head, std::ios::beg);
 
-    if(hdr.m_vers == Header::Version_v1) {
+    if(hdr.m_vers == Header::Compressed_v1) {
+      if(whichComp == -1) {    // ---- read all components
+        FabCompress::decompress(*infs, fab->dataPtr(), fab->box().numPts() * fab->nComp(),
+                                hdr.m_writtenRD);
+      } else {    // ---- the record holds all components
+        FArrayBox allComps(fab_box, hdr.m_ncomp);
+        FabCompress::decompress(*infs, allComps.dataPtr(), fab_box.numPts() * hdr.m_ncomp,
+                                hdr.m_writtenRD);
+        fab->copy(allComps, whichComp, 0, 1);
+      }
+    } else if(hdr.m_vers == Header::Version_v1) {
       if(whichComp == -1) {    // ---- read all components
         fab->readFrom(*infs);
       } else {
@@ -1411,7 +1741,10 @@ VisMF::readFAB (FabArray<FArrayBox> &mf,
     std::ifstream *infs = VisMF::OpenStream(FullName);
     infs->seekg(hdr.m_fod[idx].m_head, std::ios::beg);
 
-    if(NoFabHeader(hdr)) {
+    if(hdr.m_vers == Header::Compressed_v1) {
+      FabCompress::decompress(*infs, fab.dataPtr(), fab.box().numPts() * fab.nComp(),
+                              hdr.m_writtenRD);
+    } else if(NoFabHeader(hdr)) {
       if(hdr.m_writtenRD == FPC::NativeRealDescriptor()) {
         infs->read((char *) fab.dataPtr(), fab.nBytes());
       } else {
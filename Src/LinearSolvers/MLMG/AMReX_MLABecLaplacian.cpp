@@ -1,11 +1,62 @@
 
 #include <AMReX_MLABecLaplacian.H>
 #include <AMReX_MultiFabUtil.H>
+#include <AMReX_MultiFabUtil_C.H>
 
 #include <AMReX_MLABecLap_K.H>
 
 namespace amrex {
 
+namespace {
+
+    // whether fabs a and b differ over bx
+    bool differs (Box const& bx, FArrayBox const& a, FArrayBox const& b)
+    {
+        const auto aa = a.array();
+        const auto ba = b.array();
+        const auto lo = amrex::lbound(bx);
+        const auto hi = amrex::ubound(bx);
+        for         (int k = lo.z; k <= hi.z; ++k) {
+            for     (int j = lo.y; j <= hi.y; ++j) {
+                for (int i = lo.x; i <= hi.x; ++i) {
+                    if (aa(i,j,k) != ba(i,j,k)) return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // copy the boxes of src that differ from those of dst and flag them
+    void copyChanged (MultiFab& dst, MultiFab const& src, LayoutData<int>& changed)
+    {
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        for (MFIter mfi(dst); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.validbox();
+            if (differs(bx, dst[mfi], src[mfi])) {
+                dst[mfi].copy(src[mfi], bx, 0, bx, 0, 1);
+                changed[mfi] = 1;
+            }
+        }
+    }
+
+    // flag the boxes where cur differs from old
+    void flagChanged (MultiFab const& cur, MultiFab const& old, LayoutData<int>& changed)
+    {
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        for (MFIter mfi(cur); mfi.isValid(); ++mfi)
+        {
+            if (differs(mfi.validbox(), cur[mfi], old[mfi])) {
+                changed[mfi] = 1;
+            }
+        }
+    }
+}
+
 MLABecLaplacian::MLABecLaplacian (const Vector<Geometry>& a_geom,
                                   const Vector<BoxArray>& a_grids,
                                   const Vector<DistributionMapping>& a_dmap,
@@ -47,6 +98,30 @@ MLABecLaplacian::define (const Vector<Geometry>& a_geom,
             }
         }
     }
+
+    m_wide.clear();
+    m_wide.resize(m_num_amr_levels);
+    for (int amrlev = 0; amrlev < m_num_amr_levels; ++amrlev) {
+        m_wide[amrlev].resize(m_num_mg_levels[amrlev]);
+    }
+
+    m_stencil.clear();
+    m_stencil.resize(m_num_amr_levels);
+    m_fstencil.clear();
+    m_fstencil.resize(m_num_amr_levels);
+    m_changed.clear();
+    m_changed.resize(m_num_amr_levels);
+    for (int amrlev = 0; amrlev < m_num_amr_levels; ++amrlev)
+    {
+        m_stencil[amrlev].resize(m_num_mg_levels[amrlev]);
+        m_fstencil[amrlev].resize(m_num_mg_levels[amrlev]);
+        m_changed[amrlev].resize(m_num_mg_levels[amrlev]);
+        for (int mglev = 0; mglev < m_num_mg_levels[amrlev]; ++mglev)
+        {
+            m_changed[amrlev][mglev].define(m_grids[amrlev][mglev], m_dmap[amrlev][mglev]);
+        }
+    }
+    setChanged(1);
 }
 
 MLABecLaplacian::~MLABecLaplacian ()
@@ -55,8 +130,19 @@ MLABecLaplacian::~MLABecLaplacian ()
 void
 MLABecLaplacian::setScalars (Real a, Real b)
 {
+    // the packed stencil depends on the scalars
+    if (a != m_a_scalar || b != m_b_scalar) {
+        setChanged(1);
+        if (m_packed) m_needs_update = true;
+        for (auto& v : m_fstencil) {
+            for (auto& p : v) {
+                p.reset();
+            }
+        }
+    }
     m_a_scalar = a;
     m_b_scalar = b;
+    invalidateWideCoeffs();
     if (a == 0.0)
     {
         for (int amrlev = 0; amrlev < m_num_amr_levels; ++amrlev)
@@ -66,10 +152,65 @@ MLABecLaplacian::setScalars (Real a, Real b)
     }
 }
 
+void
+MLABecLaplacian::setSmoother (Smoother a_smoother, int a_degree)
+{
+    AMREX_ALWAYS_ASSERT(a_degree >= 1);
+    m_smoother = a_smoother;
+    m_cheby_degree = a_degree;
+    clearWideLevels();
+}
+
+void
+MLABecLaplacian::setSweepsPerExchange (int nsweeps, int min_mglev)
+{
+    AMREX_ALWAYS_ASSERT(nsweeps >= 1);
+    m_sweeps_per_exchange = nsweeps;
+    m_wide_min_mglev = min_mglev;
+    clearWideLevels();
+}
+
+void
+MLABecLaplacian::setPackedStencil (bool a_packed)
+{
+    if (a_packed == m_packed) return;
+    m_packed = a_packed;
+    for (auto& v : m_stencil) {
+        for (auto& mf : v) {
+            mf.clear();
+        }
+    }
+    if (m_packed) m_needs_update = true;
+}
+
+void
+MLABecLaplacian::setIncrementalUpdate (bool a_incremental)
+{
+    m_incremental = a_incremental;
+    // the flags are not kept without it
+    setChanged(1);
+}
+
+void
+MLABecLaplacian::setChanged (int flag)
+{
+    for (auto& v : m_changed) {
+        for (auto& changed : v) {
+            for (MFIter mfi(changed); mfi.isValid(); ++mfi) {
+                changed[mfi] = flag;
+            }
+        }
+    }
+}
+
 void
 MLABecLaplacian::setACoeffs (int amrlev, const MultiFab& alpha)
 {
-    MultiFab::Copy(m_a_coeffs[amrlev][0], alpha, 0, 0, 1, 0);
+    if (m_incremental) {
+        copyChanged(m_a_coeffs[amrlev][0], alpha, m_changed[amrlev][0]);
+    } else {
+        MultiFab::Copy(m_a_coeffs[amrlev][0], alpha, 0, 0, 1, 0);
+    }
     m_needs_update = true;
 }
 
@@ -78,7 +219,11 @@ MLABecLaplacian::setBCoeffs (int amrlev,
                              const Array<MultiFab const*,AMREX_SPACEDIM>& beta)
 {
     for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
-        MultiFab::Copy(m_b_coeffs[amrlev][0][idim], *beta[idim], 0, 0, 1, 0);
+        if (m_incremental) {
+            copyChanged(m_b_coeffs[amrlev][0][idim], *beta[idim], m_changed[amrlev][0]);
+        } else {
+            MultiFab::Copy(m_b_coeffs[amrlev][0][idim], *beta[idim], 0, 0, 1, 0);
+        }
     }
     m_needs_update = true;
 }
@@ -107,23 +252,112 @@ MLABecLaplacian::averageDownCoeffsSameAmrLevel (Vector<MultiFab>& a,
     int nmglevs = a.size();
     for (int mglev = 1; mglev < nmglevs; ++mglev)
     {
-        if (m_a_scalar == 0.0)
+        averageDownCoeffsMG(a, b, mglev);
+    }
+}
+
+void
+MLABecLaplacian::averageDownCoeffsMG (Vector<MultiFab>& a,
+                                      Vector<Array<MultiFab,AMREX_SPACEDIM> >& b, int mglev)
+{
+    if (m_a_scalar == 0.0)
+    {
+        a[mglev].setVal(0.0);
+    }
+    else
+    {
+        amrex::average_down(a[mglev-1], a[mglev], 0, 1, mg_coarsen_ratio);
+    }
+
+    Vector<const MultiFab*> fine {AMREX_D_DECL(&(b[mglev-1][0]),
+                                               &(b[mglev-1][1]),
+                                               &(b[mglev-1][2]))};
+    Vector<MultiFab*> crse {AMREX_D_DECL(&(b[mglev][0]),
+                                         &(b[mglev][1]),
+                                         &(b[mglev][2]))};
+    IntVect ratio {mg_coarsen_ratio};
+    amrex::average_down_faces(fine, crse, ratio, 0);
+}
+
+void
+MLABecLaplacian::averageDownChangedCoeffs ()
+{
+    BL_PROFILE("MLABecLaplacian::averageDownChangedCoeffs()");
+
+    for (int amrlev = m_num_amr_levels-1; amrlev >= 0; --amrlev)
+    {
+        averageDownChangedCoeffsSameAmrLevel(amrlev);
+
+        if (amrlev > 0)
         {
-            a[mglev].setVal(0.0);
+            // the coarse AMR level is averaged down as a whole; compare it
+            // with its old values to find the boxes that changed
+            MultiFab& crse_a_coeffs = m_a_coeffs[amrlev-1].front();
+            auto& crse_b_coeffs = m_b_coeffs[amrlev-1].front();
+            MultiFab old_a(crse_a_coeffs.boxArray(), crse_a_coeffs.DistributionMap(), 1, 0);
+            MultiFab::Copy(old_a, crse_a_coeffs, 0, 0, 1, 0);
+            Array<MultiFab,AMREX_SPACEDIM> old_b;
+            for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+                old_b[idim].define(crse_b_coeffs[idim].boxArray(),
+                                   crse_b_coeffs[idim].DistributionMap(), 1, 0);
+                MultiFab::Copy(old_b[idim], crse_b_coeffs[idim], 0, 0, 1, 0);
+            }
+
+            averageDownCoeffsToCoarseAmrLevel(amrlev);
+
+            LayoutData<int>& changed = m_changed[amrlev-1][0];
+            flagChanged(crse_a_coeffs, old_a, changed);
+            for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+                flagChanged(crse_b_coeffs[idim], old_b[idim], changed);
+            }
         }
-        else
+    }
+}
+
+void
+MLABecLaplacian::averageDownChangedCoeffsSameAmrLevel (int amrlev)
+{
+    auto& a = m_a_coeffs[amrlev];
+    auto& b = m_b_coeffs[amrlev];
+    const IntVect ratio {mg_coarsen_ratio};
+
+    for (int mglev = 1; mglev < m_num_mg_levels[amrlev]; ++mglev)
+    {
+        LayoutData<int>& changed = m_changed[amrlev][mglev];
+        const LayoutData<int>& fine_changed = m_changed[amrlev][mglev-1];
+
+        // a box can be averaged down from the box of the same index
+        const bool boxwise = m_dmap[amrlev][mglev] == m_dmap[amrlev][mglev-1]
+            && m_grids[amrlev][mglev] == amrex::coarsen(m_grids[amrlev][mglev-1],
+                                                        mg_coarsen_ratio);
+        if (!boxwise)
         {
-            amrex::average_down(a[mglev-1], a[mglev], 0, 1, mg_coarsen_ratio);
+            averageDownCoeffsMG(a, b, mglev);
+            for (MFIter mfi(changed); mfi.isValid(); ++mfi) {
+                changed[mfi] = 1;
+            }
+            continue;
+        }
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        for (MFIter mfi(a[mglev]); mfi.isValid(); ++mfi)
+        {
+            changed[mfi] = fine_changed[mfi.index()];
+            if (!changed[mfi]) continue;
+
+            const Box& bx = mfi.validbox();
+            if (m_a_scalar == 0.0) {
+                a[mglev][mfi].setVal(0.0, bx, 0, 1);
+            } else {
+                amrex_avgdown(bx, a[mglev][mfi], a[mglev-1][mfi], 0, 0, 1, ratio);
+            }
+            for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+                amrex_avgdown_faces(amrex::surroundingNodes(bx,idim), b[mglev][idim][mfi],
+                                    b[mglev-1][idim][mfi], 0, 0, 1, ratio, idim);
+            }
         }
-        
-        Vector<const MultiFab*> fine {AMREX_D_DECL(&(b[mglev-1][0]),
-                                                   &(b[mglev-1][1]),
-                                                   &(b[mglev-1][2]))};
-        Vector<MultiFab*> crse {AMREX_D_DECL(&(b[mglev][0]),
-                                             &(b[mglev][1]),
-                                             &(b[mglev][2]))};
-        IntVect ratio {mg_coarsen_ratio};
-        amrex::average_down_faces(fine, crse, ratio, 0);
     }
 }
 
@@ -186,6 +420,11 @@ MLABecLaplacian::prepareForSolve ()
 #endif
 
     averageDownCoeffs();
+    invalidateWideCoeffs();
+
+    setChanged(1);
+    buildStencils();
+    setChanged(0);
 
     m_is_singular.clear();
     m_is_singular.resize(m_num_amr_levels, false);
@@ -214,11 +453,189 @@ MLABecLaplacian::prepareForSolve ()
     m_needs_update = false;
 }
 
+void
+MLABecLaplacian::buildStencils ()
+{
+    BL_PROFILE("MLABecLaplacian::buildStencils()");
+
+    for (int amrlev = 0; amrlev < m_num_amr_levels; ++amrlev)
+    {
+        for (int mglev = 0; mglev < m_num_mg_levels[amrlev]; ++mglev)
+        {
+            if (m_packed)
+            {
+                MultiFab& stencil = m_stencil[amrlev][mglev];
+                const bool all = stencil.empty();
+                if (all) {
+                    stencil.define(m_grids[amrlev][mglev], m_dmap[amrlev][mglev],
+                                   2*AMREX_SPACEDIM+1, 0, MFInfo(), *m_factory[amrlev][mglev]);
+                }
+                fillStencil(amrlev, mglev, stencil, all);
+            }
+            if (m_fstencil[amrlev][mglev]) {
+                fillStencil(amrlev, mglev, *m_fstencil[amrlev][mglev], false);
+            }
+        }
+    }
+}
+
+template <class MF>
+void
+MLABecLaplacian::fillStencil (int amrlev, int mglev, MF& stencil, bool all) const
+{
+    const LayoutData<int>& changed = m_changed[amrlev][mglev];
+
+    const MultiFab& acoef = m_a_coeffs[amrlev][mglev];
+    AMREX_D_TERM(const MultiFab& bxcoef = m_b_coeffs[amrlev][mglev][0];,
+                 const MultiFab& bycoef = m_b_coeffs[amrlev][mglev][1];,
+                 const MultiFab& bzcoef = m_b_coeffs[amrlev][mglev][2];);
+
+    const Real* h = m_geom[amrlev][mglev].CellSize();
+    AMREX_D_TERM(const Real dhx = m_b_scalar/(h[0]*h[0]);,
+                 const Real dhy = m_b_scalar/(h[1]*h[1]);,
+                 const Real dhz = m_b_scalar/(h[2]*h[2]));
+    const Real alpha = m_a_scalar;
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(stencil, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        if (!all && !changed[mfi]) continue;
+
+        const Box& bx = mfi.tilebox();
+        const auto& stfab = stencil.array(mfi);
+        const auto& afab = acoef.array(mfi);
+        AMREX_D_TERM(const auto& bxfab = bxcoef.array(mfi);,
+                     const auto& byfab = bycoef.array(mfi);,
+                     const auto& bzfab = bzcoef.array(mfi););
+
+        AMREX_LAUNCH_HOST_DEVICE_LAMBDA ( bx, tbx,
+        {
+            mlabeclap_stencil(tbx, stfab, afab, AMREX_D_DECL(bxfab,byfab,bzfab),
+                              alpha, AMREX_D_DECL(dhx,dhy,dhz));
+        });
+    }
+}
+
+const MLLinOp::fMultiFab&
+MLABecLaplacian::getFloatStencil (int amrlev, int mglev) const
+{
+    std::unique_ptr<fMultiFab>& p = m_fstencil[amrlev][mglev];
+    if (!p) {
+        p.reset(new fMultiFab(m_grids[amrlev][mglev], m_dmap[amrlev][mglev],
+                              2*AMREX_SPACEDIM+1, 0));
+        fillStencil(amrlev, mglev, *p, true);
+    }
+    return *p;
+}
+
+void
+MLABecLaplacian::FapplyF (int amrlev, int mglev, fMultiFab& out, const fMultiFab& in) const
+{
+    BL_PROFILE("MLABecLaplacian::FapplyF()");
+
+    const fMultiFab& stencil = getFloatStencil(amrlev, mglev);
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(out, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+        const auto& xfab = in.array(mfi);
+        const auto& yfab = out.array(mfi);
+        const auto& stfab = stencil.array(mfi);
+        AMREX_LAUNCH_HOST_DEVICE_LAMBDA ( bx, tbx,
+        {
+            mlabeclap_adotx_stencil(tbx, yfab, xfab, stfab);
+        });
+    }
+}
+
+void
+MLABecLaplacian::FsmoothF (int amrlev, int mglev, fMultiFab& sol, const fMultiFab& rhs,
+                           int redblack) const
+{
+    BL_PROFILE("MLABecLaplacian::FsmoothF()");
+
+    const fMultiFab& stencil = getFloatStencil(amrlev, mglev);
+
+    const auto& undrrelxr = m_undrrelxr[amrlev][mglev];
+    const auto& maskvals  = m_maskvals [amrlev][mglev];
+    Array<FabSet const*, 2*AMREX_SPACEDIM> fs;
+    int iface = 0;
+    for (OrientationIter oitr; oitr; ++oitr, ++iface) {
+        fs[iface] = &undrrelxr[oitr()];
+    }
+
+    const int nc = 1;
+
+    MFItInfo mfi_info;
+    if (Gpu::notInLaunchRegion()) mfi_info.EnableTiling().SetDynamic(true);
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(sol,mfi_info); mfi.isValid(); ++mfi)
+    {
+        const Box& tbx = mfi.tilebox();
+        const Box& vbx = mfi.validbox();
+        const auto& solnfab = sol.array(mfi);
+        const auto& rhsfab  = rhs.array(mfi);
+        const auto& stfab   = stencil.array(mfi);
+
+#if (AMREX_SPACEDIM == 1)
+        abec_gsrb_stencil(tbx, solnfab, rhsfab, stfab,
+                          fs[0]->array(mfi), maskvals[0].array(mfi),
+                          fs[1]->array(mfi), maskvals[1].array(mfi),
+                          vbx, nc, redblack);
+#elif (AMREX_SPACEDIM == 2)
+        abec_gsrb_stencil(tbx, solnfab, rhsfab, stfab,
+                          fs[0]->array(mfi), maskvals[0].array(mfi),
+                          fs[1]->array(mfi), maskvals[1].array(mfi),
+                          fs[2]->array(mfi), maskvals[2].array(mfi),
+                          fs[3]->array(mfi), maskvals[3].array(mfi),
+                          vbx, nc, redblack);
+#else
+        abec_gsrb_stencil(tbx, solnfab, rhsfab, stfab,
+                          fs[0]->array(mfi), maskvals[0].array(mfi),
+                          fs[1]->array(mfi), maskvals[1].array(mfi),
+                          fs[2]->array(mfi), maskvals[2].array(mfi),
+                          fs[3]->array(mfi), maskvals[3].array(mfi),
+                          fs[4]->array(mfi), maskvals[4].array(mfi),
+                          fs[5]->array(mfi), maskvals[5].array(mfi),
+                          vbx, nc, redblack);
+#endif
+    }
+}
+
 void
 MLABecLaplacian::Fapply (int amrlev, int mglev, MultiFab& out, const MultiFab& in) const
 {
     BL_PROFILE("MLABecLaplacian::Fapply()");
 
+    if (m_packed)
+    {
+        const MultiFab& stencil = m_stencil[amrlev][mglev];
+        AMREX_ASSERT(!stencil.empty());
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(out, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.tilebox();
+            const auto& xfab = in.array(mfi);
+            const auto& yfab = out.array(mfi);
+            const auto& stfab = stencil.array(mfi);
+            AMREX_LAUNCH_HOST_DEVICE_LAMBDA ( bx, tbx,
+            {
+                mlabeclap_adotx_stencil(tbx, yfab, xfab, stfab);
+            });
+        }
+        return;
+    }
+
     const MultiFab& acoef = m_a_coeffs[amrlev][mglev];
     AMREX_D_TERM(const MultiFab& bxcoef = m_b_coeffs[amrlev][mglev][0];,
                  const MultiFab& bycoef = m_b_coeffs[amrlev][mglev][1];,
@@ -255,6 +672,26 @@ MLABecLaplacian::normalize (int amrlev, int mglev, MultiFab& mf) const
 {
     BL_PROFILE("MLABecLaplacian::normalize()");
 
+    if (m_packed)
+    {
+        const MultiFab& stencil = m_stencil[amrlev][mglev];
+        AMREX_ASSERT(!stencil.empty());
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(mf, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.tilebox();
+            const auto& fab = mf.array(mfi);
+            const auto& stfab = stencil.array(mfi);
+            AMREX_LAUNCH_HOST_DEVICE_LAMBDA ( bx, tbx,
+            {
+                mlabeclap_normalize_stencil(tbx, fab, stfab);
+            });
+        }
+        return;
+    }
+
     const MultiFab& acoef = m_a_coeffs[amrlev][mglev];
     AMREX_D_TERM(const MultiFab& bxcoef = m_b_coeffs[amrlev][mglev][0];,
                  const MultiFab& bycoef = m_b_coeffs[amrlev][mglev][1];,
@@ -328,6 +765,10 @@ MLABecLaplacian::Fsmooth (int amrlev, int mglev, MultiFab& sol, const MultiFab&
                  const Real dhz = m_b_scalar/(h[2]*h[2]));
     const Real alpha = m_a_scalar;
 
+    const bool packed = m_packed;
+    const MultiFab& stencil = m_stencil[amrlev][mglev];
+    AMREX_ASSERT(!packed || !stencil.empty());
+
     MFItInfo mfi_info;
     if (Gpu::notInLaunchRegion()) mfi_info.EnableTiling().SetDynamic(true);
 
@@ -368,6 +809,43 @@ MLABecLaplacian::Fsmooth (int amrlev, int mglev, MultiFab& sol, const MultiFab&
 #endif
 #endif
 
+        if (packed)
+        {
+            const auto& stfab = stencil.array(mfi);
+#if (AMREX_SPACEDIM == 1)
+            AMREX_LAUNCH_HOST_DEVICE_LAMBDA ( tbx, thread_box,
+            {
+                abec_gsrb_stencil(thread_box, solnfab, rhsfab, stfab,
+                                  f0fab, m0,
+                                  f1fab, m1,
+                                  vbx, nc, redblack);
+            });
+#elif (AMREX_SPACEDIM == 2)
+            AMREX_LAUNCH_HOST_DEVICE_LAMBDA ( tbx, thread_box,
+            {
+                abec_gsrb_stencil(thread_box, solnfab, rhsfab, stfab,
+                                  f0fab, m0,
+                                  f1fab, m1,
+                                  f2fab, m2,
+                                  f3fab, m3,
+                                  vbx, nc, redblack);
+            });
+#else
+            AMREX_LAUNCH_HOST_DEVICE_LAMBDA ( tbx, thread_box,
+            {
+                abec_gsrb_stencil(thread_box, solnfab, rhsfab, stfab,
+                                  f0fab, m0,
+                                  f1fab, m1,
+                                  f2fab, m2,
+                                  f3fab, m3,
+                                  f4fab, m4,
+                                  f5fab, m5,
+                                  vbx, nc, redblack);
+            });
+#endif
+            continue;
+        }
+
 #if (AMREX_SPACEDIM == 1)
         AMREX_LAUNCH_HOST_DEVICE_LAMBDA ( tbx, thread_box,
         {
@@ -409,6 +887,428 @@ MLABecLaplacian::Fsmooth (int amrlev, int mglev, MultiFab& sol, const MultiFab&
     }
 }
 
+void
+MLABecLaplacian::clearWideLevels ()
+{
+    for (auto& v : m_wide) {
+        for (auto& w : v) {
+            w.reset();
+        }
+    }
+}
+
+void
+MLABecLaplacian::invalidateWideCoeffs ()
+{
+    for (auto& v : m_wide) {
+        for (auto& w : v) {
+            if (w) w->coeffs_ok = false;
+        }
+    }
+}
+
+bool
+MLABecLaplacian::useWideGhosts (int amrlev, int mglev) const
+{
+    const bool cheby = (m_smoother == Smoother::Chebyshev);
+    if (!cheby && (m_sweeps_per_exchange <= 1 || mglev < m_wide_min_mglev)) return false;
+    // the ghost cells must be filled by one periodic shift, and red and
+    // black must match across periodic boundaries
+    const Geometry& geom = m_geom[amrlev][mglev];
+    for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+        if (geom.isPeriodic(idim)) {
+            const int len = geom.Domain().length(idim);
+            if (len < wideGhosts() || (!cheby && len % 2 != 0)) return false;
+        }
+    }
+    return true;
+}
+
+int
+MLABecLaplacian::sweepsPerSmooth (int amrlev, int mglev) const
+{
+    if (m_smoother == Smoother::GSRB && useWideGhosts(amrlev, mglev)) {
+        return m_sweeps_per_exchange;
+    } else {
+        return 1;
+    }
+}
+
+void
+MLABecLaplacian::smooth (int amrlev, int mglev, MultiFab& sol, const MultiFab& rhs,
+                         bool skip_fillboundary) const
+{
+    if (!useWideGhosts(amrlev, mglev)) {
+        MLCellLinOp::smooth(amrlev, mglev, sol, rhs, skip_fillboundary);
+    } else if (m_smoother == Smoother::Chebyshev) {
+        smoothChebyshev(amrlev, mglev, sol, rhs);
+    } else {
+        smoothGSRBWide(amrlev, mglev, sol, rhs);
+    }
+}
+
+MLABecLaplacian::WideLevel&
+MLABecLaplacian::getWideLevel (int amrlev, int mglev) const
+{
+    std::unique_ptr<WideLevel>& p = m_wide[amrlev][mglev];
+    if (p && p->coeffs_ok) return *p;
+
+    BL_PROFILE("MLABecLaplacian::getWideLevel()");
+
+    const Periodicity& period = m_geom[amrlev][mglev].periodicity();
+    const bool cheby = (m_smoother == Smoother::Chebyshev);
+
+    if (!p) defineWideLevel(amrlev, mglev);
+    WideLevel& w = *p;
+    const int ng = w.ng;
+
+    MultiFab::Copy(w.acoef, m_a_coeffs[amrlev][mglev], 0, 0, 1, 0);
+    w.acoef.FillBoundary(period);
+    for (int idim = 0; idim < AMREX_SPACEDIM; ++idim)
+    {
+        MultiFab::Copy(w.bcoef[idim], m_b_coeffs[amrlev][mglev][idim], 0, 0, 1, 0);
+        w.bcoef[idim].FillBoundary(period);
+    }
+
+    if (cheby)
+    {
+        const auto& undrrelxr = m_undrrelxr[amrlev][mglev];
+        const auto& maskvals  = m_maskvals [amrlev][mglev];
+        Array<FabSet const*, 2*AMREX_SPACEDIM> fs;
+        int iface = 0;
+        for (OrientationIter oitr; oitr; ++oitr, ++iface) {
+            fs[iface] = &undrrelxr[oitr()];
+        }
+
+        const Real* h = m_geom[amrlev][mglev].CellSize();
+        AMREX_D_TERM(const Real dhx = m_b_scalar/(h[0]*h[0]);,
+                     const Real dhy = m_b_scalar/(h[1]*h[1]);,
+                     const Real dhz = m_b_scalar/(h[2]*h[2]));
+        const Real alpha = m_a_scalar;
+
+        Real lambda = 0.0;
+#ifdef _OPENMP
+#pragma omp parallel reduction(max:lambda)
+#endif
+        for (MFIter mfi(w.dinv); mfi.isValid(); ++mfi)
+        {
+            const Box& vbx = mfi.validbox();
+            const Box& gbx = amrex::grow(vbx, ng-1);
+            const auto& dinvfab = w.dinv.array(mfi);
+            const auto& afab = w.acoef.array(mfi);
+            AMREX_D_TERM(const auto& bxfab = w.bcoef[0].array(mfi);,
+                         const auto& byfab = w.bcoef[1].array(mfi);,
+                         const auto& bzfab = w.bcoef[2].array(mfi););
+            const auto& sf = w.safe.array(mfi);
+            w.dinv[mfi].setVal(0.0);
+#if (AMREX_SPACEDIM == 1)
+            const Real l = abec_jacobi_dinv(gbx, dinvfab, alpha, dhx, afab, bxfab,
+                                            fs[0]->array(mfi), maskvals[0].array(mfi),
+                                            fs[1]->array(mfi), maskvals[1].array(mfi),
+                                            sf, vbx);
+#elif (AMREX_SPACEDIM == 2)
+            const Real l = abec_jacobi_dinv(gbx, dinvfab, alpha, dhx, dhy, afab, bxfab, byfab,
+                                            fs[0]->array(mfi), maskvals[0].array(mfi),
+                                            fs[1]->array(mfi), maskvals[1].array(mfi),
+                                            fs[2]->array(mfi), maskvals[2].array(mfi),
+                                            fs[3]->array(mfi), maskvals[3].array(mfi),
+                                            sf, vbx);
+#else
+            const Real l = abec_jacobi_dinv(gbx, dinvfab, alpha, dhx, dhy, dhz,
+                                            afab, bxfab, byfab, bzfab,
+                                            fs[0]->array(mfi), maskvals[0].array(mfi),
+                                            fs[1]->array(mfi), maskvals[1].array(mfi),
+                                            fs[2]->array(mfi), maskvals[2].array(mfi),
+                                            fs[3]->array(mfi), maskvals[3].array(mfi),
+                                            fs[4]->array(mfi), maskvals[4].array(mfi),
+                                            fs[5]->array(mfi), maskvals[5].array(mfi),
+                                            sf, vbx);
+#endif
+            lambda = std::max(lambda, l);
+        }
+        ParallelAllReduce::Max(lambda, Communicator(amrlev, mglev));
+        w.lambda = lambda;
+    }
+
+    w.coeffs_ok = true;
+    return w;
+}
+
+void
+MLABecLaplacian::defineWideLevel (int amrlev, int mglev) const
+{
+    std::unique_ptr<WideLevel>& p = m_wide[amrlev][mglev];
+    p.reset(new WideLevel);
+    WideLevel& w = *p;
+
+    const BoxArray& ba = m_grids[amrlev][mglev];
+    const DistributionMapping& dm = m_dmap[amrlev][mglev];
+    const auto& factory = *m_factory[amrlev][mglev];
+    const Periodicity& period = m_geom[amrlev][mglev].periodicity();
+    const int ng = wideGhosts();
+    w.ng = ng;
+
+    w.work.define(ba, dm, 2, ng, MFInfo(), factory);
+    w.work.setVal(0.0);
+
+    // the stencil of the outermost updated layer reaches the coefficients
+    // of ng-1 ghost cells; they are 0 outside the domain
+    w.acoef.define(ba, dm, 1, ng-1, MFInfo(), factory);
+    w.acoef.setVal(0.0);
+    for (int idim = 0; idim < AMREX_SPACEDIM; ++idim)
+    {
+        const BoxArray& fba = amrex::convert(ba, IntVect::TheDimensionVector(idim));
+        w.bcoef[idim].define(fba, dm, 1, ng-1, MFInfo(), factory);
+        w.bcoef[idim].setVal(0.0);
+    }
+
+    // a ghost cell is updated if it and its neighbors are valid cells of
+    // the level, so that its owner updates it the same way
+    iMultiFab covered(ba, dm, 1, ng+1);
+    covered.setVal(0);
+    covered.setVal(1, 0, 1, 0);
+    covered.FillBoundary(period);
+
+    w.safe.define(ba, dm, 1, ng);
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(w.safe); mfi.isValid(); ++mfi)
+    {
+        const Box& vbx = mfi.validbox();
+        const Box& gbx = amrex::grow(vbx, ng);
+        const auto& c = covered.array(mfi);
+        const auto& sf = w.safe.array(mfi);
+        AMREX_HOST_DEVICE_FOR_3D (gbx, i, j, k,
+        {
+            int ok = c(i,j,k);
+            AMREX_D_TERM(ok = ok && c(i-1,j,k) && c(i+1,j,k);,
+                         ok = ok && c(i,j-1,k) && c(i,j+1,k);,
+                         ok = ok && c(i,j,k-1) && c(i,j,k+1););
+            sf(i,j,k) = ok || vbx.contains(IntVect(AMREX_D_DECL(i,j,k)));
+        });
+    }
+
+    if (m_smoother == Smoother::Chebyshev)
+    {
+        w.dir.define(ba, dm, 1, ng, MFInfo(), factory);
+        w.res.define(ba, dm, 1, ng, MFInfo(), factory);
+        w.adir.define(ba, dm, 1, ng, MFInfo(), factory);
+        w.dinv.define(ba, dm, 1, ng, MFInfo(), factory);
+        w.dir.setVal(0.0);
+        w.res.setVal(0.0);
+        w.adir.setVal(0.0);
+    }
+}
+
+void
+MLABecLaplacian::smoothGSRBWide (int amrlev, int mglev, MultiFab& sol, const MultiFab& rhs) const
+{
+    BL_PROFILE("MLABecLaplacian::smoothGSRBWide()");
+
+    WideLevel& w = getWideLevel(amrlev, mglev);
+    const int ng = w.ng;
+
+    MultiFab::Copy(w.work, sol, 0, 0, 1, 0);
+    MultiFab::Copy(w.work, rhs, 0, 1, 1, 0);
+    w.work.FillBoundaryPersistent(0, 2, IntVect(ng), m_geom[amrlev][mglev].periodicity());
+
+    const auto& undrrelxr = m_undrrelxr[amrlev][mglev];
+    const auto& maskvals  = m_maskvals [amrlev][mglev];
+    Array<FabSet const*, 2*AMREX_SPACEDIM> fs;
+    int iface = 0;
+    for (OrientationIter oitr; oitr; ++oitr, ++iface) {
+        fs[iface] = &undrrelxr[oitr()];
+    }
+
+    const Real* h = m_geom[amrlev][mglev].CellSize();
+    AMREX_D_TERM(const Real dhx = m_b_scalar/(h[0]*h[0]);,
+                 const Real dhy = m_b_scalar/(h[1]*h[1]);,
+                 const Real dhz = m_b_scalar/(h[2]*h[2]));
+    const Real alpha = m_a_scalar;
+
+    MFItInfo mfi_info;
+    if (Gpu::notInLaunchRegion()) mfi_info.EnableTiling().SetDynamic(true);
+
+    // half-sweep hs is exact in ng-1-hs ghost layers, the last one in the valid cells
+    for (int hs = 0; hs < ng; ++hs)
+    {
+        applyBC(amrlev, mglev, w.work, BCMode::Homogeneous, StateMode::Solution, nullptr, true);
+
+        const int redblack = hs % 2;
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(w.work, mfi_info); mfi.isValid(); ++mfi)
+        {
+            const Box& tbx = mfi.growntilebox(ng-1-hs);
+            const Box& vbx = mfi.validbox();
+            FArrayBox& wfab = w.work[mfi];
+            const Array4<Real> solnfab(wfab.dataPtr(0), amrex::begin(wfab.box()), amrex::end(wfab.box()));
+            const Array4<Real const> rhsfab(wfab.dataPtr(1), amrex::begin(wfab.box()), amrex::end(wfab.box()));
+            const auto& afab = w.acoef.array(mfi);
+            AMREX_D_TERM(const auto& bxfab = w.bcoef[0].array(mfi);,
+                         const auto& byfab = w.bcoef[1].array(mfi);,
+                         const auto& bzfab = w.bcoef[2].array(mfi););
+            const auto& sf = w.safe.array(mfi);
+
+#if (AMREX_SPACEDIM == 1)
+            abec_gsrb_ca(tbx, solnfab, rhsfab, alpha, dhx, afab, bxfab,
+                         fs[0]->array(mfi), maskvals[0].array(mfi),
+                         fs[1]->array(mfi), maskvals[1].array(mfi),
+                         sf, vbx, redblack);
+#elif (AMREX_SPACEDIM == 2)
+            abec_gsrb_ca(tbx, solnfab, rhsfab, alpha, dhx, dhy, afab, bxfab, byfab,
+                         fs[0]->array(mfi), maskvals[0].array(mfi),
+                         fs[1]->array(mfi), maskvals[1].array(mfi),
+                         fs[2]->array(mfi), maskvals[2].array(mfi),
+                         fs[3]->array(mfi), maskvals[3].array(mfi),
+                         sf, vbx, redblack);
+#else
+            abec_gsrb_ca(tbx, solnfab, rhsfab, alpha, dhx, dhy, dhz,
+                         afab, bxfab, byfab, bzfab,
+                         fs[0]->array(mfi), maskvals[0].array(mfi),
+                         fs[1]->array(mfi), maskvals[1].array(mfi),
+                         fs[2]->array(mfi), maskvals[2].array(mfi),
+                         fs[3]->array(mfi), maskvals[3].array(mfi),
+                         fs[4]->array(mfi), maskvals[4].array(mfi),
+                         fs[5]->array(mfi), maskvals[5].array(mfi),
+                         sf, vbx, redblack);
+#endif
+        }
+    }
+
+    MultiFab::Copy(sol, w.work, 0, 0, 1, 0);
+}
+
+void
+MLABecLaplacian::smoothChebyshev (int amrlev, int mglev, MultiFab& sol, const MultiFab& rhs) const
+{
+    BL_PROFILE("MLABecLaplacian::smoothChebyshev()");
+
+    WideLevel& w = getWideLevel(amrlev, mglev);
+    const int ng = w.ng;
+
+    MultiFab::Copy(w.work, sol, 0, 0, 1, 0);
+    MultiFab::Copy(w.work, rhs, 0, 1, 1, 0);
+    w.work.FillBoundaryPersistent(0, 2, IntVect(ng), m_geom[amrlev][mglev].periodicity());
+    applyBC(amrlev, mglev, w.work, BCMode::Homogeneous, StateMode::Solution, nullptr, true);
+
+    const auto dxinv = m_geom[amrlev][mglev].InvCellSizeArray();
+    const Real ascalar = m_a_scalar;
+    const Real bscalar = m_b_scalar;
+
+    const Real lmax = w.lambda;
+    const Real lmin = lmax / (2*AMREX_SPACEDIM);
+    const Real theta = 0.5*(lmax + lmin);
+    const Real delta = 0.5*(lmax - lmin);
+    const Real sigma = theta / delta;
+    Real rho = 1.0 / sigma;
+
+    // r = D^{-1} (b - A x), d = r / theta, exact in ng-1 layers
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(w.work, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.growntilebox(ng-1);
+        FArrayBox& wfab = w.work[mfi];
+        const Array4<Real const> xfab(wfab.dataPtr(0), amrex::begin(wfab.box()), amrex::end(wfab.box()));
+        const Array4<Real const> bfab(wfab.dataPtr(1), amrex::begin(wfab.box()), amrex::end(wfab.box()));
+        const auto& afab = w.acoef.array(mfi);
+        AMREX_D_TERM(const auto& bxfab = w.bcoef[0].array(mfi);,
+                     const auto& byfab = w.bcoef[1].array(mfi);,
+                     const auto& bzfab = w.bcoef[2].array(mfi););
+        const auto& axfab = w.adir.array(mfi);
+        const auto& rfab = w.res.array(mfi);
+        const auto& dfab = w.dir.array(mfi);
+        const auto& dinvfab = w.dinv.array(mfi);
+        AMREX_LAUNCH_HOST_DEVICE_LAMBDA ( bx, tbx,
+        {
+            mlabeclap_adotx(tbx, axfab, xfab, afab, AMREX_D_DECL(bxfab,byfab,bzfab),
+                            dxinv, ascalar, bscalar);
+        });
+        AMREX_HOST_DEVICE_FOR_3D (bx, i, j, k,
+        {
+            rfab(i,j,k) = dinvfab(i,j,k) * (bfab(i,j,k) - axfab(i,j,k));
+            dfab(i,j,k) = rfab(i,j,k) / theta;
+        });
+    }
+
+    for (int m = 1; m < m_cheby_degree; ++m)
+    {
+        applyBC(amrlev, mglev, w.dir, BCMode::Homogeneous, StateMode::Correction, nullptr, true);
+
+        // r -= D^{-1} A d, exact in ng-1-m layers
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(w.work, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.growntilebox(ng-1-m);
+            const auto& afab = w.acoef.array(mfi);
+            AMREX_D_TERM(const auto& bxfab = w.bcoef[0].array(mfi);,
+                         const auto& byfab = w.bcoef[1].array(mfi);,
+                         const auto& bzfab = w.bcoef[2].array(mfi););
+            const auto& adfab = w.adir.array(mfi);
+            const auto& rfab = w.res.array(mfi);
+            const auto& dfab = w.dir.array(mfi);
+            const auto& dinvfab = w.dinv.array(mfi);
+            AMREX_LAUNCH_HOST_DEVICE_LAMBDA ( bx, tbx,
+            {
+                mlabeclap_adotx(tbx, adfab, dfab, afab, AMREX_D_DECL(bxfab,byfab,bzfab),
+                                dxinv, ascalar, bscalar);
+            });
+            AMREX_HOST_DEVICE_FOR_3D (bx, i, j, k,
+            {
+                rfab(i,j,k) -= dinvfab(i,j,k) * adfab(i,j,k);
+            });
+        }
+
+        // x += d in the valid cells, the only ones copied back; d = c1 d + c2 r
+        const Real rho_new = 1.0 / (2.0*sigma - rho);
+        const Real c1 = rho_new * rho;
+        const Real c2 = 2.0 * rho_new / delta;
+        rho = rho_new;
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(w.work, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& tbx = mfi.tilebox();
+            const Box& bx = mfi.growntilebox(ng-1-m);
+            const auto& xfab = w.work.array(mfi);
+            const auto& rfab = w.res.array(mfi);
+            const auto& dfab = w.dir.array(mfi);
+            AMREX_HOST_DEVICE_FOR_3D (tbx, i, j, k,
+            {
+                xfab(i,j,k) += dfab(i,j,k);
+            });
+            AMREX_HOST_DEVICE_FOR_3D (bx, i, j, k,
+            {
+                dfab(i,j,k) = c1*dfab(i,j,k) + c2*rfab(i,j,k);
+            });
+        }
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(w.work, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& tbx = mfi.tilebox();
+        const auto& xfab = w.work.array(mfi);
+        const auto& dfab = w.dir.array(mfi);
+        AMREX_HOST_DEVICE_FOR_3D (tbx, i, j, k,
+        {
+            xfab(i,j,k) += dfab(i,j,k);
+        });
+    }
+
+    MultiFab::Copy(sol, w.work, 0, 0, 1, 0);
+}
+
 void
 MLABecLaplacian::FFlux (int amrlev, const MFIter& mfi,
                         const Array<FArrayBox*,AMREX_SPACEDIM>& flux,
@@ -500,11 +1400,22 @@ MLABecLaplacian::update ()
 {
     if (MLCellABecLap::needsUpdate()) MLCellABecLap::update();
 
+    if (m_incremental && m_geom[0][0].IsCartesian())
+    {
+        averageDownChangedCoeffs();
+    }
+    else
+    {
 #if (AMREX_SPACEDIM != 3)
-    applyMetricTermsCoeffs();
+        applyMetricTermsCoeffs();
 #endif
+        averageDownCoeffs();
+        setChanged(1);
+    }
+    invalidateWideCoeffs();
 
-    averageDownCoeffs();
+    buildStencils();
+    setChanged(0);
 
     m_is_singular.clear();
     m_is_singular.resize(m_num_amr_levels, false);
@@ -48,6 +48,8 @@ sxay (MultiFab&       ss,
 
 }
 
+constexpr int MLCGSolver::max_sstep;
+
 MLCGSolver::MLCGSolver (MLMG* a_mlmg, MLLinOp& _lp, Type _typ)
     : mlmg(a_mlmg),
       Lp(_lp),
@@ -67,9 +69,16 @@ MLCGSolver::solve (MultiFab&       sol,
                    Real            eps_rel,
                    Real            eps_abs)
 {
-    if (solver_type == Type::BiCGStab) {
+    switch (solver_type) {
+    case Type::BiCGStab:
         return solve_bicgstab(sol,rhs,eps_rel,eps_abs);
-    } else {
+    case Type::PipelinedBiCGStab:
+        return solve_pipelined_bicgstab(sol,rhs,eps_rel,eps_abs);
+    case Type::PipelinedCG:
+        return solve_pipelined_cg(sol,rhs,eps_rel,eps_abs);
+    case Type::SStepCG:
+        return solve_sstep_cg(sol,rhs,eps_rel,eps_abs);
+    default:
         return solve_cg(sol,rhs,eps_rel,eps_abs);
     }
 }
@@ -389,6 +398,657 @@ MLCGSolver::solve_cg (MultiFab&       sol,
     return ret;
 }
 
+//
+// Ghysels and Vanroose's pipelined CG.  The dot products and the norm of the
+// residual of an iteration are reduced together while q = A w is computed,
+// which also means that convergence is known one matvec late.
+//
+int
+MLCGSolver::solve_pipelined_cg (MultiFab&       sol,
+                                const MultiFab& rhs,
+                                Real            eps_rel,
+                                Real            eps_abs)
+{
+    BL_PROFILE("MLCGSolver::pipelined_cg");
+
+    const int nghost = sol.nGrow(), ncomp = sol.nComp();
+
+    const BoxArray& ba = sol.boxArray();
+    const DistributionMapping& dm = sol.DistributionMap();
+    const auto& factory = sol.Factory();
+
+    MultiFab r(ba, dm, ncomp, nghost, MFInfo(), factory);
+    MultiFab w(ba, dm, ncomp, nghost, MFInfo(), factory);
+    r.setVal(0.0);
+    w.setVal(0.0);
+
+    MultiFab sorig(ba, dm, ncomp, 0, MFInfo(), factory);
+    MultiFab p    (ba, dm, ncomp, 0, MFInfo(), factory);
+    MultiFab s    (ba, dm, ncomp, 0, MFInfo(), factory);
+    MultiFab z    (ba, dm, ncomp, 0, MFInfo(), factory);
+    MultiFab q    (ba, dm, ncomp, 0, MFInfo(), factory);
+
+    MultiFab::Copy(sorig,sol,0,0,ncomp,0);
+
+    Lp.correctionResidual(amrlev, mglev, r, sol, rhs, MLLinOp::BCMode::Homogeneous);
+
+    sol.setVal(0);
+
+    Lp.apply(amrlev, mglev, w, r, MLLinOp::BCMode::Homogeneous, MLLinOp::StateMode::Correction);
+
+    MultiFabReduce red;
+    const int irr = addDot(red, r, r), iwr = addDot(red, w, r), irn = red.addNorm0(r, 0, ncomp);
+    red.reduceStart(0, Lp.BottomCommunicator());
+    Lp.apply(amrlev, mglev, q, w, MLLinOp::BCMode::Homogeneous, MLLinOp::StateMode::Correction);
+    red.reduceFinish();
+
+    Real       rnorm    = red.value(irn);
+    const Real rnorm0   = rnorm;
+
+    if ( verbose > 0 )
+    {
+        amrex::Print() << "MLCGSolver_PipelinedCG: Initial error (error0) :        " << rnorm0 << '\n';
+    }
+
+    Real gamma_1       = 0;
+    Real alpha_1       = 0;
+    int  ret           = 0;
+    int  nit           = 1;
+
+    if ( rnorm0 == 0 || rnorm0 < eps_abs )
+    {
+        if ( verbose > 0 ) {
+            amrex::Print() << "MLCGSolver_PipelinedCG: niter = 0,"
+                           << ", rnorm = " << rnorm
+                           << ", eps_abs = " << eps_abs << std::endl;
+        }
+        return ret;
+    }
+
+    for (; nit <= maxiter; ++nit)
+    {
+        const Real gamma = red.value(irr);
+        const Real delta = red.value(iwr);
+
+        if ( gamma == 0 )
+        {
+            ret = 1; break;
+        }
+
+        Real alpha, beta;
+        if (nit == 1)
+        {
+            beta = 0;
+            alpha = delta ? gamma/delta : 0;
+        }
+        else
+        {
+            beta = gamma/gamma_1;
+            const Real den = delta - beta*gamma/alpha_1;
+            alpha = den ? gamma/den : 0;
+        }
+        if ( alpha == 0 )
+        {
+            ret = 1; break;
+        }
+
+        if ( verbose > 2 )
+        {
+            amrex::Print() << "MLCGSolver_PipelinedCG:"
+                           << " nit " << nit
+                           << " gamma " << gamma
+                           << " alpha " << alpha << '\n';
+        }
+
+        if (nit == 1)
+        {
+            MultiFab::Copy(z,q,0,0,ncomp,0);
+            MultiFab::Copy(s,w,0,0,ncomp,0);
+            MultiFab::Copy(p,r,0,0,ncomp,0);
+        }
+        else
+        {
+            sxay(z, q, beta, z);
+            sxay(s, w, beta, s);
+            sxay(p, r, beta, p);
+        }
+        sxay(sol, sol, alpha, p);
+        sxay(  r,   r,-alpha, s);
+        sxay(  w,   w,-alpha, z);
+
+        red.reduceStart(0, Lp.BottomCommunicator());
+        Lp.apply(amrlev, mglev, q, w, MLLinOp::BCMode::Homogeneous, MLLinOp::StateMode::Correction);
+        red.reduceFinish();
+
+        rnorm = red.value(irn);
+
+        if ( verbose > 2 )
+        {
+            amrex::Print() << "MLCGSolver_PipelinedCG:       Iteration"
+                           << std::setw(4) << nit
+                           << " rel. err. "
+                           << rnorm/(rnorm0) << '\n';
+        }
+
+        if ( rnorm < eps_rel*rnorm0 || rnorm < eps_abs ) break;
+
+        gamma_1 = gamma;
+        alpha_1 = alpha;
+    }
+
+    if ( verbose > 0 )
+    {
+        amrex::Print() << "MLCGSolver_PipelinedCG: Final Iteration"
+                       << std::setw(4) << nit
+                       << " rel. err. "
+                       << rnorm/(rnorm0) << '\n';
+    }
+
+    if ( ret == 0 &&  rnorm > eps_rel*rnorm0 && rnorm > eps_abs )
+    {
+        if ( verbose > 0 && ParallelDescriptor::IOProcessor() )
+            amrex::Warning("MLCGSolver_PipelinedCG: failed to converge!");
+        ret = 8;
+    }
+
+    if ( ( ret == 0 || ret == 8 ) && (rnorm < rnorm0) )
+    {
+        sol.plus(sorig, 0, ncomp, 0);
+    }
+    else
+    {
+        sol.setVal(0);
+        sol.plus(sorig, 0, ncomp, 0);
+    }
+
+    if ( ret == 0 )
+    {
+        ret = checkTrueResidual(sol, rhs, std::max(eps_rel*rnorm0, eps_abs), Type::CG);
+    }
+
+    return ret;
+}
+
+//
+// Cools and Vanroose's pipelined BiCGStab, with the operator normalized as
+// in solve_bicgstab.  Each half iteration does one fused reduction, overlapped
+// with v = A z and t = A w respectively.
+//
+int
+MLCGSolver::solve_pipelined_bicgstab (MultiFab&       sol,
+                                      const MultiFab& rhs,
+                                      Real            eps_rel,
+                                      Real            eps_abs)
+{
+    BL_PROFILE("MLCGSolver::pipelined_bicgstab");
+
+    const int nghost = sol.nGrow(), ncomp = sol.nComp();
+
+    const BoxArray& ba = sol.boxArray();
+    const DistributionMapping& dm = sol.DistributionMap();
+    const auto& factory = sol.Factory();
+
+    MultiFab r(ba, dm, ncomp, nghost, MFInfo(), factory);
+    MultiFab w(ba, dm, ncomp, nghost, MFInfo(), factory);
+    MultiFab z(ba, dm, ncomp, nghost, MFInfo(), factory);
+    r.setVal(0.0);
+    w.setVal(0.0);
+    z.setVal(0.0);
+
+    MultiFab sorig(ba, dm, ncomp, 0, MFInfo(), factory);
+    MultiFab rh   (ba, dm, ncomp, 0, MFInfo(), factory);
+    MultiFab p    (ba, dm, ncomp, 0, MFInfo(), factory);
+    MultiFab s    (ba, dm, ncomp, 0, MFInfo(), factory);
+    MultiFab t    (ba, dm, ncomp, 0, MFInfo(), factory);
+    MultiFab v    (ba, dm, ncomp, 0, MFInfo(), factory);
+    MultiFab q    (ba, dm, ncomp, 0, MFInfo(), factory);
+    MultiFab y    (ba, dm, ncomp, 0, MFInfo(), factory);
+
+    auto apply = [&] (MultiFab& out, MultiFab& in)
+    {
+        Lp.apply(amrlev, mglev, out, in, MLLinOp::BCMode::Homogeneous, MLLinOp::StateMode::Correction);
+        Lp.normalize(amrlev, mglev, out);
+    };
+
+    Lp.correctionResidual(amrlev, mglev, r, sol, rhs, MLLinOp::BCMode::Homogeneous);
+    Lp.normalize(amrlev, mglev, r);
+
+    MultiFab::Copy(sorig,sol,0,0,ncomp,0);
+    MultiFab::Copy(rh,   r,  0,0,ncomp,0);
+
+    sol.setVal(0);
+
+    apply(w, r);
+
+    // the reductions of the first and second half of an iteration
+    MultiFabReduce red_q;
+    const int iqy = addDot(red_q, q, y), iyy = addDot(red_q, y, y), iqn = red_q.addNorm0(q, 0, ncomp);
+    MultiFabReduce red_r;
+    const int irr = addDot(red_r, rh, r), irw = addDot(red_r, rh, w), irn = red_r.addNorm0(r, 0, ncomp);
+    const int irs = addDot(red_r, rh, s), irz = addDot(red_r, rh, z);
+    s.setVal(0.0);
+
+    red_r.reduceStart(0, Lp.BottomCommunicator());
+    apply(t, w);
+    red_r.reduceFinish();
+
+    Real rnorm = red_r.value(irn);
+    const Real rnorm0   = rnorm;
+
+    if ( verbose > 0 )
+    {
+        amrex::Print() << "MLCGSolver_PipelinedBiCGStab: Initial error (error0) =        " << rnorm0 << '\n';
+    }
+    int ret = 0, nit = 1;
+    Real rho = red_r.value(irr), alpha = 0, beta = 0, omega = 0;
+
+    if ( rnorm0 == 0 || rnorm0 < eps_abs )
+    {
+        if ( verbose > 0 )
+        {
+            amrex::Print() << "MLCGSolver_PipelinedBiCGStab: niter = 0,"
+                           << ", rnorm = " << rnorm
+                           << ", eps_abs = " << eps_abs << std::endl;
+        }
+        return ret;
+    }
+
+    if ( rho == 0 )
+    {
+        ret = 1;
+    }
+    else if ( red_r.value(irw) == 0 )
+    {
+        ret = 2;
+    }
+    else
+    {
+        alpha = rho/red_r.value(irw);
+    }
+
+    for (; ret == 0 && nit <= maxiter; ++nit)
+    {
+        if ( nit == 1 )
+        {
+            MultiFab::Copy(p,r,0,0,ncomp,0);
+            MultiFab::Copy(s,w,0,0,ncomp,0);
+            MultiFab::Copy(z,t,0,0,ncomp,0);
+        }
+        else
+        {
+            sxay(p, p, -omega, s);
+            sxay(p, r,   beta, p);
+            sxay(s, s, -omega, z);
+            sxay(s, w,   beta, s);
+            sxay(z, z, -omega, v);
+            sxay(z, t,   beta, z);
+        }
+        sxay(q, r, -alpha, s);
+        sxay(y, w, -alpha, z);
+
+        red_q.reduceStart(0, Lp.BottomCommunicator());
+        apply(v, z);
+        red_q.reduceFinish();
+
+        rnorm = red_q.value(iqn);
+
+        if ( verbose > 2 )
+        {
+            amrex::Print() << "MLCGSolver_PipelinedBiCGStab: Half Iter "
+                           << std::setw(11) << nit
+                           << " rel. err. "
+                           << rnorm/(rnorm0) << '\n';
+        }
+
+        if ( rnorm < eps_rel*rnorm0 || rnorm < eps_abs )
+        {
+            sxay(sol, sol, alpha, p);
+            break;
+        }
+
+        if ( red_q.value(iyy) )
+        {
+            omega = red_q.value(iqy)/red_q.value(iyy);
+        }
+        else
+        {
+            ret = 3; break;
+        }
+        sxay(sol, sol, alpha, p);
+        sxay(sol, sol, omega, q);
+        sxay(r,     q, -omega, y);
+        sxay(t,     t, -alpha, v);
+        sxay(w,     y, -omega, t);
+
+        red_r.reduceStart(0, Lp.BottomCommunicator());
+        apply(t, w);
+        red_r.reduceFinish();
+
+        rnorm = red_r.value(irn);
+
+        if ( verbose > 2 )
+        {
+            amrex::Print() << "MLCGSolver_PipelinedBiCGStab: Iteration "
+                           << std::setw(11) << nit
+                           << " rel. err. "
+                           << rnorm/(rnorm0) << '\n';
+        }
+
+        if ( rnorm < eps_rel*rnorm0 || rnorm < eps_abs ) break;
+
+        if ( omega == 0 )
+        {
+            ret = 4; break;
+        }
+        const Real rho_new = red_r.value(irr);
+        if ( rho_new == 0 )
+        {
+            ret = 1; break;
+        }
+        beta = (alpha/omega)*(rho_new/rho);
+        if ( Real den = red_r.value(irw) + beta*red_r.value(irs) - beta*omega*red_r.value(irz) )
+        {
+            alpha = rho_new/den;
+        }
+        else
+        {
+            ret = 2; break;
+        }
+        rho = rho_new;
+    }
+
+    if ( verbose > 0 )
+    {
+        amrex::Print() << "MLCGSolver_PipelinedBiCGStab: Final: Iteration "
+                       << std::setw(4) << nit
+                       << " rel. err. "
+                       << rnorm/(rnorm0) << '\n';
+    }
+
+    if ( ret == 0 && rnorm > eps_rel*rnorm0 && rnorm > eps_abs)
+    {
+        if ( verbose > 0 && ParallelDescriptor::IOProcessor() )
+            amrex::Warning("MLCGSolver_PipelinedBiCGStab:: failed to converge!");
+        ret = 8;
+    }
+
+    if ( ( ret == 0 || ret == 8 ) && (rnorm < rnorm0) )
+    {
+        sol.plus(sorig, 0, ncomp, 0);
+    }
+    else
+    {
+        sol.setVal(0);
+        sol.plus(sorig, 0, ncomp, 0);
+    }
+
+    if ( ret == 0 )
+    {
+        ret = checkTrueResidual(sol, rhs, std::max(eps_rel*rnorm0, eps_abs), Type::BiCGStab);
+    }
+
+    return ret;
+}
+
+//
+// s-step CG with the scaled monomial basis
+//     V = [p, A p/sigma, ..., (A/sigma)^s p, r, A r/sigma, ..., (A/sigma)^(s-1) r],
+// sigma being an estimate of the norm of A.  One reduction gives the Gram
+// matrix of V and the norm of r; the s iterations are then done on the
+// coordinates in V, in which A is the shift matrix times sigma.
+//
+int
+MLCGSolver::solve_sstep_cg (MultiFab&       sol,
+                            const MultiFab& rhs,
+                            Real            eps_rel,
+                            Real            eps_abs)
+{
+    BL_PROFILE("MLCGSolver::sstep_cg");
+
+    const int nghost = sol.nGrow(), ncomp = sol.nComp();
+    const int ns = sstep;
+    const int m  = 2*ns + 1;
+
+    const BoxArray& ba = sol.boxArray();
+    const DistributionMapping& dm = sol.DistributionMap();
+    const auto& factory = sol.Factory();
+
+    Vector<std::unique_ptr<MultiFab> > V(m);
+    for (auto& vi : V) {
+        vi.reset(new MultiFab(ba, dm, ncomp, nghost, MFInfo(), factory));
+        vi->setVal(0.0);
+    }
+
+    MultiFab sorig(ba, dm, ncomp, 0, MFInfo(), factory);
+    MultiFab r    (ba, dm, ncomp, 0, MFInfo(), factory);
+    MultiFab p    (ba, dm, ncomp, 0, MFInfo(), factory);
+
+    MultiFab::Copy(sorig,sol,0,0,ncomp,0);
+
+    Lp.correctionResidual(amrlev, mglev, r, sol, rhs, MLLinOp::BCMode::Homogeneous);
+
+    sol.setVal(0);
+
+    // ---- sigma = |A r|_2 / |r|_2, reduced with the initial norm
+    MultiFab::Copy(*V[0],r,0,0,ncomp,0);
+    Lp.apply(amrlev, mglev, *V[1], *V[0], MLLinOp::BCMode::Homogeneous, MLLinOp::StateMode::Correction);
+
+    Real rnorm, rr, aa;
+    {
+        MultiFabReduce red;
+        const int irr = addDot(red, r, r), iaa = addDot(red, *V[1], *V[1]), irn = red.addNorm0(r, 0, ncomp);
+        red.reduceStart(0, Lp.BottomCommunicator());
+        red.reduceFinish();
+        rr = red.value(irr);
+        aa = red.value(iaa);
+        rnorm = red.value(irn);
+    }
+    const Real rnorm0   = rnorm;
+    const Real sigma    = (rr > 0 && aa > 0) ? std::sqrt(aa/rr) : 1.0;
+
+    if ( verbose > 0 )
+    {
+        amrex::Print() << "MLCGSolver_SStepCG: Initial error (error0) :        " << rnorm0 << '\n';
+    }
+
+    int  ret           = 0;
+    int  nit           = 0;
+
+    if ( rnorm0 == 0 || rnorm0 < eps_abs )
+    {
+        if ( verbose > 0 ) {
+            amrex::Print() << "MLCGSolver_SStepCG: niter = 0,"
+                           << ", rnorm = " << rnorm
+                           << ", eps_abs = " << eps_abs << std::endl;
+        }
+        return ret;
+    }
+
+    MultiFab::Copy(p,r,0,0,ncomp,0);
+
+    // ---- the upper triangle of the Gram matrix and |r|
+    MultiFabReduce red;
+    Vector<int> ig(m*m);
+    for (int i = 0; i < m; ++i) {
+        for (int j = i; j < m; ++j) {
+            ig[i*m+j] = ig[j*m+i] = addDot(red, *V[i], *V[j]);
+        }
+    }
+    const int irn = red.addNorm0(r, 0, ncomp);
+
+    Vector<Real> G(m*m);
+    Vector<Real> pc(m), rc(m), xc(m), Bp(m);
+
+    auto gdot = [&] (const Vector<Real>& a, const Vector<Real>& b) -> Real
+    {
+        Real d = 0;
+        for (int i = 0; i < m; ++i) {
+            Real gb = 0;
+            for (int j = 0; j < m; ++j) gb += G[i*m+j]*b[j];
+            d += a[i]*gb;
+        }
+        return d;
+    };
+
+    // ---- the product with A in the coordinates of V
+    auto shift = [&] (const Vector<Real>& a, Vector<Real>& b)
+    {
+        std::fill(b.begin(), b.end(), 0.0);
+        for (int i = 0; i < ns; ++i)   b[i+1]    = sigma*a[i];
+        for (int i = 0; i < ns-1; ++i) b[ns+2+i] = sigma*a[ns+1+i];
+    };
+
+    while (nit < maxiter)
+    {
+        // ---- the basis
+        MultiFab::Copy(*V[0],   p,0,0,ncomp,0);
+        MultiFab::Copy(*V[ns+1],r,0,0,ncomp,0);
+        for (int i = 0; i < ns; ++i) {
+            Lp.apply(amrlev, mglev, *V[i+1], *V[i], MLLinOp::BCMode::Homogeneous, MLLinOp::StateMode::Correction);
+            V[i+1]->mult(1.0/sigma, 0, ncomp, 0);
+        }
+        for (int i = 0; i < ns-1; ++i) {
+            Lp.apply(amrlev, mglev, *V[ns+2+i], *V[ns+1+i], MLLinOp::BCMode::Homogeneous, MLLinOp::StateMode::Correction);
+            V[ns+2+i]->mult(1.0/sigma, 0, ncomp, 0);
+        }
+
+        red.reduceStart(0, Lp.BottomCommunicator());
+        red.reduceFinish();
+
+        for (int i = 0; i < m*m; ++i) {
+            G[i] = red.value(ig[i]);
+        }
+        rnorm = red.value(irn);
+
+        if ( nit > 0 && verbose > 2 )
+        {
+            amrex::Print() << "MLCGSolver_SStepCG:       Iteration"
+                           << std::setw(4) << nit
+                           << " rel. err. "
+                           << rnorm/(rnorm0) << '\n';
+        }
+
+        if ( rnorm < eps_rel*rnorm0 || rnorm < eps_abs ) break;
+
+        // ---- s iterations on the coordinates
+        std::fill(pc.begin(), pc.end(), 0.0);
+        std::fill(rc.begin(), rc.end(), 0.0);
+        std::fill(xc.begin(), xc.end(), 0.0);
+        pc[0]    = 1.0;
+        rc[ns+1] = 1.0;
+
+        Real rho = gdot(rc,rc);
+        int j = 0;
+        for (; j < ns && nit < maxiter; ++j, ++nit)
+        {
+            shift(pc, Bp);
+            const Real pw = gdot(pc,Bp);
+            if ( rho <= 0 || pw <= 0 )
+            {
+                ret = 1; break;
+            }
+            const Real alpha = rho/pw;
+            for (int i = 0; i < m; ++i) {
+                xc[i] += alpha*pc[i];
+                rc[i] -= alpha*Bp[i];
+            }
+            const Real rho_new = gdot(rc,rc);
+            const Real beta = rho_new/rho;
+            for (int i = 0; i < m; ++i) {
+                pc[i] = rc[i] + beta*pc[i];
+            }
+            rho = rho_new;
+        }
+
+        // ---- back to the fine vectors
+        for (int i = 0; i < m; ++i) {
+            if (xc[i] != 0) MultiFab::Saxpy(sol, xc[i], *V[i], 0, 0, ncomp, 0);
+        }
+        if (ret != 0) break;
+
+        r.setVal(0.0);
+        p.setVal(0.0);
+        for (int i = 0; i < m; ++i) {
+            if (rc[i] != 0) MultiFab::Saxpy(r, rc[i], *V[i], 0, 0, ncomp, 0);
+            if (pc[i] != 0) MultiFab::Saxpy(p, pc[i], *V[i], 0, 0, ncomp, 0);
+        }
+    }
+
+    if (ret == 0 && nit == maxiter) {
+        rnorm = norm_inf(r);
+    }
+
+    if ( verbose > 0 )
+    {
+        amrex::Print() << "MLCGSolver_SStepCG: Final Iteration"
+                       << std::setw(4) << nit
+                       << " rel. err. "
+                       << rnorm/(rnorm0) << '\n';
+    }
+
+    if ( ret == 0 &&  rnorm > eps_rel*rnorm0 && rnorm > eps_abs )
+    {
+        if ( verbose > 0 && ParallelDescriptor::IOProcessor() )
+            amrex::Warning("MLCGSolver_SStepCG: failed to converge!");
+        ret = 8;
+    }
+
+    if ( ( ret == 0 || ret == 8 ) && (rnorm < rnorm0) )
+    {
+        sol.plus(sorig, 0, ncomp, 0);
+    }
+    else
+    {
+        sol.setVal(0);
+        sol.plus(sorig, 0, ncomp, 0);
+    }
+
+    // a breakdown here is the basis losing accuracy, CG starts over
+    if ( ret == 0 || ret == 1 )
+    {
+        ret = checkTrueResidual(sol, rhs, std::max(eps_rel*rnorm0, eps_abs), Type::CG);
+    }
+
+    return ret;
+}
+
+//
+// The pipelined and s-step solvers update the residual by recurrence, which
+// drifts from the true residual of the solution.  When one of them reports
+// convergence, the true residual of sol is checked against the target, and
+// if it misses it the classic solver continues from sol.
+//
+int
+MLCGSolver::checkTrueResidual (MultiFab&       sol,
+                               const MultiFab& rhs,
+                               Real            target,
+                               Type            fallback)
+{
+    BL_PROFILE("MLCGSolver::checkTrueResidual");
+
+    MultiFab r(sol.boxArray(), sol.DistributionMap(), sol.nComp(), 0, MFInfo(), sol.Factory());
+    Lp.correctionResidual(amrlev, mglev, r, sol, rhs, MLLinOp::BCMode::Homogeneous);
+    if (fallback == Type::BiCGStab) Lp.normalize(amrlev, mglev, r);
+
+    const Real rnorm = norm_inf(r);
+    if ( rnorm < target ) return 0;
+
+    if ( verbose > 0 )
+    {
+        amrex::Print() << "MLCGSolver: true residual " << rnorm << " above " << target
+                       << ", continuing with " << (fallback == Type::CG ? "CG" : "BiCGStab") << '\n';
+    }
+
+    return (fallback == Type::CG) ? solve_cg(sol, rhs, 0.0, target)
+                                  : solve_bicgstab(sol, rhs, 0.0, target);
+}
+
+int
+MLCGSolver::addDot (MultiFabReduce& red, const MultiFab& x, const MultiFab& y) const
+{
+    return red.addDot(x, 0, y, 0, x.nComp(), Lp.dotWeights(amrlev, mglev));
+}
+
 Real
 MLCGSolver::dotxy (const MultiFab& r, const MultiFab& z, bool local)
 {
@@ -571,6 +571,192 @@ MLCellLinOp::applyBC (int amrlev, int mglev, MultiFab& in, BCMode bc_mode, State
     }
 }
 
+void
+MLCellLinOp::applyBCF (int amrlev, int mglev, fMultiFab& in, bool skip_fillboundary) const
+{
+    BL_PROFILE("MLCellLinOp::applyBCF()");
+    AMREX_ALWAYS_ASSERT(isCrossStencil());
+
+    const int ncomp = getNComp();
+    if (!skip_fillboundary) {
+        in.FillBoundary(0, ncomp, m_geom[amrlev][mglev].periodicity(), true);
+    }
+
+    const int flagbc = 0;
+    const int imaxorder = maxorder;
+
+    const Real dxi = m_geom[amrlev][mglev].InvCellSize(0);
+    const Real dyi = (AMREX_SPACEDIM >= 2) ? m_geom[amrlev][mglev].InvCellSize(1) : 1.0;
+    const Real dzi = (AMREX_SPACEDIM == 3) ? m_geom[amrlev][mglev].InvCellSize(2) : 1.0;
+
+    const auto& maskvals = m_maskvals[amrlev][mglev];
+    const auto& bcondloc = *m_bcondloc[amrlev][mglev];
+
+    // the boundary values are not used with homogeneous conditions
+    FArrayBox foofab(Box::TheUnitBox(),ncomp);
+    const Array4<Real const> foo = foofab.array();
+
+    MFItInfo mfi_info;
+
+    if (Gpu::notInLaunchRegion()) mfi_info.SetDynamic(true);
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(in, mfi_info); mfi.isValid(); ++mfi)
+    {
+        const Box& vbx   = mfi.validbox();
+        const auto& iofab = in.array(mfi);
+
+        const RealTuple & bdl = bcondloc.bndryLocs(mfi);
+        const BCTuple   & bdc = bcondloc.bndryConds(mfi);
+
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim)
+        {
+            const Orientation olo(idim,Orientation::low);
+            const Orientation ohi(idim,Orientation::high);
+            const Box blo = amrex::adjCellLo(vbx, idim);
+            const Box bhi = amrex::adjCellHi(vbx, idim);
+            const int blen = vbx.length(idim);
+            const auto& mlo = maskvals[olo].array(mfi);
+            const auto& mhi = maskvals[ohi].array(mfi);
+            const BoundCond bctlo = bdc[olo];
+            const BoundCond bcthi = bdc[ohi];
+            const Real bcllo = bdl[olo];
+            const Real bclhi = bdl[ohi];
+            if (idim == 0) {
+                AMREX_LAUNCH_HOST_DEVICE_LAMBDA (
+                blo, tboxlo, {
+                    mllinop_apply_bc_x(0, tboxlo, blen, iofab, mlo,
+                                       bctlo, bcllo, foo,
+                                       imaxorder, dxi, flagbc, ncomp);
+                },
+                bhi, tboxhi, {
+                    mllinop_apply_bc_x(1, tboxhi, blen, iofab, mhi,
+                                       bcthi, bclhi, foo,
+                                       imaxorder, dxi, flagbc, ncomp);
+                });
+            } else if (idim == 1) {
+                AMREX_LAUNCH_HOST_DEVICE_LAMBDA (
+                blo, tboxlo, {
+                    mllinop_apply_bc_y(0, tboxlo, blen, iofab, mlo,
+                                       bctlo, bcllo, foo,
+                                       imaxorder, dyi, flagbc, ncomp);
+                },
+                bhi, tboxhi, {
+                    mllinop_apply_bc_y(1, tboxhi, blen, iofab, mhi,
+                                       bcthi, bclhi, foo,
+                                       imaxorder, dyi, flagbc, ncomp);
+                });
+            } else {
+                AMREX_LAUNCH_HOST_DEVICE_LAMBDA (
+                blo, tboxlo, {
+                    mllinop_apply_bc_z(0, tboxlo, blen, iofab, mlo,
+                                       bctlo, bcllo, foo,
+                                       imaxorder, dzi, flagbc, ncomp);
+                },
+                bhi, tboxhi, {
+                    mllinop_apply_bc_z(1, tboxhi, blen, iofab, mhi,
+                                       bcthi, bclhi, foo,
+                                       imaxorder, dzi, flagbc, ncomp);
+                });
+            }
+        }
+    }
+}
+
+void
+MLCellLinOp::smoothF (int amrlev, int mglev, fMultiFab& sol, const fMultiFab& rhs,
+                      bool skip_fillboundary) const
+{
+    BL_PROFILE("MLCellLinOp::smoothF()");
+    for (int redblack = 0; redblack < 2; ++redblack)
+    {
+        applyBCF(amrlev, mglev, sol, skip_fillboundary);
+        FsmoothF(amrlev, mglev, sol, rhs, redblack);
+        skip_fillboundary = false;
+    }
+}
+
+void
+MLCellLinOp::correctionResidualF (int amrlev, int mglev, fMultiFab& resid, fMultiFab& x,
+                                  const fMultiFab& b) const
+{
+    BL_PROFILE("MLCellLinOp::correctionResidualF()");
+    const int ncomp = getNComp();
+    applyBCF(amrlev, mglev, x);
+    FapplyF(amrlev, mglev, resid, x);
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(resid,TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+        auto const rfab = resid.array(mfi);
+        auto const bfab = b.array(mfi);
+        AMREX_HOST_DEVICE_FOR_4D ( bx, ncomp, i, j, k, n,
+        {
+            rfab(i,j,k,n) = bfab(i,j,k,n) - rfab(i,j,k,n);
+        });
+    }
+}
+
+void
+MLCellLinOp::restrictionF (int, int, fMultiFab& crse, fMultiFab& fine) const
+{
+    const int ncomp = getNComp();
+
+    // as amrex::average_down, through a coarsened copy of the fine layout if needed
+    BoxArray cba = fine.boxArray();
+    cba.coarsen(mg_coarsen_ratio);
+    fMultiFab ctmp;
+    fMultiFab* cmf = &crse;
+    if (cba != crse.boxArray() || fine.DistributionMap() != crse.DistributionMap()) {
+        ctmp.define(cba, fine.DistributionMap(), ncomp, 0);
+        cmf = &ctmp;
+    }
+
+    const fMultiFab& cfine = fine;
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(*cmf,TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx    = mfi.tilebox();
+        auto const cfab = cmf->array(mfi);
+        auto const ffab = cfine.array(mfi);
+        AMREX_HOST_DEVICE_FOR_4D ( bx, ncomp, i, j, k, n,
+        {
+            mg_cc_restrict(i,j,k,n,cfab,ffab);
+        });
+    }
+
+    if (cmf != &crse) {
+        crse.ParallelCopy(ctmp);
+    }
+}
+
+void
+MLCellLinOp::interpolationF (int, int, fMultiFab& fine, const fMultiFab& crse) const
+{
+    const int ncomp = getNComp();
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(crse,TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx    = mfi.tilebox();
+        auto const cfab = crse.array(mfi);
+        auto       ffab = fine.array(mfi);
+        AMREX_HOST_DEVICE_FOR_4D ( bx, ncomp, i, j, k, n,
+        {
+            mg_cc_interp(i,j,k,n,ffab,cfab);
+        });
+    }
+}
+
 void
 MLCellLinOp::reflux (int crse_amrlev,
                      MultiFab& res, const MultiFab& crse_sol, const MultiFab&,
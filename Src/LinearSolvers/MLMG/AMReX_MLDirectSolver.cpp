@@ -0,0 +1,537 @@
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <AMReX_MLDirectSolver.H>
+#include <AMReX_ParallelContext.H>
+#include <AMReX_ParallelReduce.H>
+#include <AMReX_iMultiFab.H>
+
+namespace amrex {
+
+namespace {
+
+// The concatenation of v over the processes of the current communicator.
+// If counts is empty it is filled with the sizes of the pieces.
+template <class T>
+Vector<T>
+allGather (const Vector<T>& v, Vector<int>& counts)
+{
+#ifdef BL_USE_MPI
+    MPI_Comm comm = ParallelContext::CommunicatorSub();
+    const int nprocs = ParallelContext::NProcsSub();
+    int n = v.size();
+    if (counts.empty()) {
+        counts.resize(nprocs);
+        MPI_Allgather(&n, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+    }
+    Vector<int> disp(nprocs, 0);
+    for (int i = 1; i < nprocs; ++i) {
+        disp[i] = disp[i-1] + counts[i-1];
+    }
+    Vector<T> r(disp.back() + counts.back());
+    MPI_Allgatherv(const_cast<T*>(v.data()), n, ParallelDescriptor::Mpi_typemap<T>::type(),
+                   r.data(), counts.data(), disp.data(), ParallelDescriptor::Mpi_typemap<T>::type(),
+                   comm);
+    return r;
+#else
+    if (counts.empty()) counts.assign(1, v.size());
+    return v;
+#endif
+}
+
+// the values the assembled matrix is checked with
+Real testValue (int gid)
+{
+    return 1.0 + 0.5*std::sin(0.7*gid + 1.0);
+}
+
+}
+
+MLDirectSolver::MLDirectSolver (MLLinOp& a_lp)
+    : Lp(a_lp),
+      mglev(a_lp.NMGLevels(0)-1)
+{
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(Lp.isCellCentered() && Lp.getNComp() == 1,
+                                     "MLDirectSolver: only cell-centered operators with one component are supported");
+}
+
+MLDirectSolver::~MLDirectSolver ()
+{
+}
+
+bool
+MLDirectSolver::setup ()
+{
+    BL_PROFILE("MLDirectSolver::setup()");
+
+    const BoxArray& ba = Lp.m_grids[amrlev][mglev];
+    const DistributionMapping& dm = Lp.m_dmap[amrlev][mglev];
+    const Geometry& geom = Lp.m_geom[amrlev][mglev];
+    const Box& domain = geom.Domain();
+
+    // ---- the unknowns are numbered box by box
+    Vector<long> offset(ba.size()+1, 0);
+    for (int i = 0; i < ba.size(); ++i) {
+        offset[i+1] = offset[i] + ba[i].numPts();
+    }
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(offset.back() < std::numeric_limits<int>::max(),
+                                     "MLDirectSolver: the bottom level is too large");
+    m_n = offset.back();
+
+    // ---- colors i%3 in each direction; a periodic direction whose length
+    // ---- is not a multiple of 3 gives its last cells colors of their own
+    int ncolor[3] = {1, 1, 1};
+    int nlast [3] = {0, 0, 0};
+    int lo    [3] = {0, 0, 0};
+    int len   [3] = {1, 1, 1};
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+        lo[d] = domain.smallEnd(d);
+        len[d] = domain.length(d);
+        nlast[d] = geom.isPeriodic(d) ? len[d] % 3 : 0;
+        ncolor[d] = 3 + nlast[d];
+    }
+    auto color = [&] (int i, int j, int k) -> int
+    {
+        const int iv[3] = {i, j, k};
+        int c = 0;
+        for (int d = AMREX_SPACEDIM-1; d >= 0; --d) {
+            const int ii = iv[d] - lo[d];
+            const int cd = (ii >= len[d] - nlast[d]) ? 3 + ii - (len[d] - nlast[d]) : ii % 3;
+            c = c*ncolor[d] + cd;
+        }
+        return c;
+    };
+    const int ncolors = ncolor[0]*ncolor[1]*ncolor[2];
+
+    iMultiFab id(ba, dm, 2, 1);
+    id.setVal(-1);
+    Vector<int> lgids;
+    for (MFIter mfi(id); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.validbox();
+        const auto& a = id.array(mfi);
+        const Dim3 blo = amrex::lbound(bx);
+        const Dim3 bhi = amrex::ubound(bx);
+        int g = offset[mfi.index()];
+        for (int k = blo.z; k <= bhi.z; ++k) {
+        for (int j = blo.y; j <= bhi.y; ++j) {
+        for (int i = blo.x; i <= bhi.x; ++i) {
+            a(i,j,k,0) = g;
+            a(i,j,k,1) = color(i,j,k);
+            lgids.push_back(g++);
+        }}}
+    }
+    id.FillBoundary(geom.periodicity());
+
+    // ---- probe the operator with the indicator vector of each color
+    MultiFab x(ba, dm, 1, 1, MFInfo(), *Lp.Factory(amrlev,mglev));
+    MultiFab y(ba, dm, 1, 0, MFInfo(), *Lp.Factory(amrlev,mglev));
+    x.setVal(0.0);
+
+    Vector<int> lrow, lcol, lpos;   // lpos: the position of the row among the local unknowns
+    Vector<Real> lval;
+
+    const int kr = (AMREX_SPACEDIM == 3) ? 1 : 0;
+    const int jr = (AMREX_SPACEDIM >= 2) ? 1 : 0;
+
+    for (int c = 0; c < ncolors; ++c)
+    {
+        for (MFIter mfi(x); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.validbox();
+            const auto& xa = x.array(mfi);
+            const auto& a = id.array(mfi);
+            const Dim3 blo = amrex::lbound(bx);
+            const Dim3 bhi = amrex::ubound(bx);
+            for (int k = blo.z; k <= bhi.z; ++k) {
+            for (int j = blo.y; j <= bhi.y; ++j) {
+            for (int i = blo.x; i <= bhi.x; ++i) {
+                xa(i,j,k) = (a(i,j,k,1) == c) ? 1.0 : 0.0;
+            }}}
+        }
+
+        Lp.apply(amrlev, mglev, y, x, MLLinOp::BCMode::Homogeneous, MLLinOp::StateMode::Correction);
+
+        int pos = 0;
+        for (MFIter mfi(y); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.validbox();
+            const auto& ya = y.array(mfi);
+            const auto& a = id.array(mfi);
+            const Dim3 blo = amrex::lbound(bx);
+            const Dim3 bhi = amrex::ubound(bx);
+            for (int k = blo.z; k <= bhi.z; ++k) {
+            for (int j = blo.y; j <= bhi.y; ++j) {
+            for (int i = blo.x; i <= bhi.x; ++i, ++pos) {
+                // the one neighbor of color c, which may be reached through
+                // several offsets in a short periodic direction
+                int gcol = -1;
+                for (int kk = k-kr; kk <= k+kr; ++kk) {
+                for (int jj = j-jr; jj <= j+jr; ++jj) {
+                for (int ii = i-1;  ii <= i+1;  ++ii) {
+                    if (a(ii,jj,kk,0) >= 0 && a(ii,jj,kk,1) == c) {
+                        AMREX_ALWAYS_ASSERT(gcol < 0 || gcol == a(ii,jj,kk,0));
+                        gcol = a(ii,jj,kk,0);
+                    }
+                }}}
+                if (gcol >= 0 && (ya(i,j,k) != 0.0 || gcol == a(i,j,k,0))) {
+                    lrow.push_back(a(i,j,k,0));
+                    lcol.push_back(gcol);
+                    lval.push_back(ya(i,j,k));
+                    lpos.push_back(pos);
+                }
+            }}}
+        }
+    }
+
+    // ---- check the matrix against the operator
+    {
+        for (MFIter mfi(x); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.validbox();
+            const auto& xa = x.array(mfi);
+            const auto& a = id.array(mfi);
+            const Dim3 blo = amrex::lbound(bx);
+            const Dim3 bhi = amrex::ubound(bx);
+            for (int k = blo.z; k <= bhi.z; ++k) {
+            for (int j = blo.y; j <= bhi.y; ++j) {
+            for (int i = blo.x; i <= bhi.x; ++i) {
+                xa(i,j,k) = testValue(a(i,j,k,0));
+            }}}
+        }
+
+        Lp.apply(amrlev, mglev, y, x, MLLinOp::BCMode::Homogeneous, MLLinOp::StateMode::Correction);
+
+        std::vector<Real> ax(lgids.size(), 0.0);
+        for (int t = 0; t < lrow.size(); ++t) {
+            ax[lpos[t]] += lval[t]*testValue(lcol[t]);
+        }
+
+        Real errs[2] = {0.0, 0.0};
+        int t = 0;
+        for (MFIter mfi(y); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.validbox();
+            const auto& ya = y.array(mfi);
+            const Dim3 blo = amrex::lbound(bx);
+            const Dim3 bhi = amrex::ubound(bx);
+            for (int k = blo.z; k <= bhi.z; ++k) {
+            for (int j = blo.y; j <= bhi.y; ++j) {
+            for (int i = blo.x; i <= bhi.x; ++i, ++t) {
+                errs[0] = std::max(errs[0], std::abs(ya(i,j,k) - ax[t]));
+                errs[1] = std::max(errs[1], std::abs(ya(i,j,k)));
+            }}}
+        }
+        ParallelAllReduce::Max(errs, 2, Lp.BottomCommunicator());
+        if (errs[0] > 1.e-10*errs[1]) {
+            amrex::Abort("MLDirectSolver: the bottom operator does not have a 3^dim point stencil");
+        }
+    }
+
+    // ---- every process gets the whole matrix
+    Vector<int> counts;
+    Vector<int>  row = allGather(lrow, counts);
+    Vector<int>  col = allGather(lcol, counts);
+    Vector<Real> val = allGather(lval, counts);
+
+    if ((m_factored || m_too_large) && row == m_row && col == m_col && val == m_val)
+    {
+        if (verbose > 1) {
+            amrex::Print() << "MLDirectSolver: the bottom operator is unchanged\n";
+        }
+        return m_factored;
+    }
+
+    m_row.swap(row);
+    m_col.swap(col);
+    m_val.swap(val);
+    m_counts.clear();
+    m_gids = allGather(lgids, m_counts);
+    m_factored = false;
+    m_too_large = false;
+
+    // a singular bottom level has its last unknown fixed to zero
+    m_pinned = Lp.isBottomSingular() ? m_n-1 : -1;
+
+    order();
+
+    const long nbytes = long(m_n)*(m_kl+m_ku+1)*sizeof(Real);
+    if (nbytes > m_max_band_bytes)
+    {
+        amrex::Print() << "MLDirectSolver: the band of the bottom matrix needs " << nbytes
+                       << " bytes, more than the " << m_max_band_bytes
+                       << " allowed; falling back to BiCGStab\n";
+        m_too_large = true;
+        return false;
+    }
+
+    factor();
+    return true;
+}
+
+bool
+MLDirectSolver::keep (int t) const
+{
+    return (m_row[t] != m_pinned && m_col[t] != m_pinned) || m_row[t] == m_col[t];
+}
+
+void
+MLDirectSolver::order ()
+{
+    BL_PROFILE("MLDirectSolver::order()");
+
+    const int n = m_n;
+    const int nnz = m_row.size();
+
+    // ---- reverse Cuthill-McKee ordering of the symmetrized pattern
+    Vector<Vector<int> > adj(n);
+    for (int t = 0; t < nnz; ++t) {
+        if (m_row[t] != m_col[t] && keep(t)) {
+            adj[m_row[t]].push_back(m_col[t]);
+            adj[m_col[t]].push_back(m_row[t]);
+        }
+    }
+    for (auto& a : adj) {
+        std::sort(a.begin(), a.end());
+        a.erase(std::unique(a.begin(), a.end()), a.end());
+    }
+
+    m_perm.clear();
+    m_perm.reserve(n);
+    Vector<char> visited(n, 0);
+    Vector<int> level;
+    auto by_degree = [&] (int a, int b) { return adj[a].size() < adj[b].size(); };
+
+    // breadth-first from start over the unvisited nodes, appended to order
+    auto bfs = [&] (int start, Vector<int>& order, bool mark)
+    {
+        const int first = order.size();
+        Vector<char> seen;
+        if (!mark) seen = visited;
+        Vector<char>& vis = mark ? visited : seen;
+        vis[start] = 1;
+        order.push_back(start);
+        for (int q = first; q < order.size(); ++q) {
+            Vector<int> nb;
+            for (int v : adj[order[q]]) {
+                if (!vis[v]) {
+                    vis[v] = 1;
+                    nb.push_back(v);
+                }
+            }
+            std::stable_sort(nb.begin(), nb.end(), by_degree);
+            order.insert(order.end(), nb.begin(), nb.end());
+        }
+    };
+
+    for (int s = 0; s < n; ++s)
+    {
+        if (visited[s]) continue;
+        // a pseudo-peripheral start: the last node reached from s with the least degree
+        level.clear();
+        bfs(s, level, false);
+        int start = level.back();
+        for (int q = level.size()-1; q >= 0 && q >= int(level.size())-8; --q) {
+            if (adj[level[q]].size() < adj[start].size()) start = level[q];
+        }
+        bfs(start, m_perm, true);
+    }
+    std::reverse(m_perm.begin(), m_perm.end());
+
+    m_iperm.resize(n);
+    for (int i = 0; i < n; ++i) {
+        m_iperm[m_perm[i]] = i;
+    }
+
+    m_kl = m_ku = 0;
+    for (int t = 0; t < nnz; ++t) {
+        if (keep(t)) {
+            const int d = m_iperm[m_col[t]] - m_iperm[m_row[t]];
+            m_kl = std::max(m_kl, -d);
+            m_ku = std::max(m_ku,  d);
+        }
+    }
+}
+
+void
+MLDirectSolver::factor ()
+{
+    BL_PROFILE("MLDirectSolver::factor()");
+
+    const Real t0 = amrex::second();
+    const int n = m_n;
+    const int nnz = m_row.size();
+    const int pinned = m_pinned;
+
+    // ---- the band of the permuted matrix, row by row
+    const int w = m_kl + m_ku + 1;
+    Vector<Real> band(long(n)*w, 0.0);
+    auto B = [&] (int i, int j) -> Real& { return band[long(i)*w + (j - i + m_kl)]; };
+    for (int t = 0; t < nnz; ++t) {
+        if (keep(t)) {
+            B(m_iperm[m_row[t]], m_iperm[m_col[t]]) += (m_row[t] == pinned) ? 0.0 : m_val[t];
+        }
+    }
+    if (pinned >= 0) {
+        B(m_iperm[pinned], m_iperm[pinned]) = 1.0;
+    }
+
+    bool sym = (m_kl == m_ku);
+    for (int i = 0; i < n && sym; ++i) {
+        for (int j = std::max(0, i-m_kl); j < i; ++j) {
+            const Real a = B(i,j), b = B(j,i);
+            if (std::abs(a-b) > 1.e-12*(std::abs(a)+std::abs(b))) {
+                sym = false;
+                break;
+            }
+        }
+    }
+
+    // ---- Cholesky of the lower band, L(i,j) for i-kl <= j <= i
+    m_cholesky = false;
+    if (sym)
+    {
+        const int kl = m_kl;
+        const int wl = kl + 1;
+        m_band.assign(long(n)*wl, 0.0);
+        auto L = [&] (int i, int j) -> Real& { return m_band[long(i)*wl + (j - i + kl)]; };
+        m_cholesky = true;
+        for (int j = 0; j < n && m_cholesky; ++j)
+        {
+            Real d = B(j,j);
+            for (int k = std::max(0, j-kl); k < j; ++k) {
+                d -= L(j,k)*L(j,k);
+            }
+            if ( ! (d > 0.0)) {
+                m_cholesky = false;
+                break;
+            }
+            L(j,j) = std::sqrt(d);
+            for (int i = j+1; i <= std::min(n-1, j+kl); ++i) {
+                Real s = B(i,j);
+                for (int k = std::max(0, i-kl); k < j; ++k) {
+                    s -= L(i,k)*L(j,k);
+                }
+                L(i,j) = s/L(j,j);
+            }
+        }
+    }
+
+    // ---- LU without pivoting in place of the band
+    if (!m_cholesky)
+    {
+        for (int k = 0; k < n; ++k)
+        {
+            const Real piv = B(k,k);
+            if ( ! (std::abs(piv) > 0.0) || ! std::isfinite(piv)) {
+                amrex::Abort("MLDirectSolver: zero pivot in the LU factorization");
+            }
+            const int jmax = std::min(n-1, k+m_ku);
+            for (int i = k+1; i <= std::min(n-1, k+m_kl); ++i) {
+                Real& lik = B(i,k);
+                if (lik == 0.0) continue;
+                lik /= piv;
+                for (int j = k+1; j <= jmax; ++j) {
+                    B(i,j) -= lik*B(k,j);
+                }
+            }
+        }
+        m_band.swap(band);
+    }
+
+    m_factored = true;
+    ++m_nfactor;
+
+    if (verbose > 0) {
+        amrex::Print() << "MLDirectSolver: " << n << " unknowns, bandwidths " << m_kl << " " << m_ku
+                       << ", " << (m_cholesky ? "Cholesky" : "LU") << " factorization in "
+                       << amrex::second() - t0 << " seconds\n";
+    }
+}
+
+void
+MLDirectSolver::solve (MultiFab& x, const MultiFab& b)
+{
+    BL_PROFILE("MLDirectSolver::solve()");
+
+    AMREX_ASSERT(m_factored);
+
+    Vector<Real> lb;
+    for (MFIter mfi(b); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.validbox();
+        const auto& ba = b.array(mfi);
+        const Dim3 blo = amrex::lbound(bx);
+        const Dim3 bhi = amrex::ubound(bx);
+        for (int k = blo.z; k <= bhi.z; ++k) {
+        for (int j = blo.y; j <= bhi.y; ++j) {
+        for (int i = blo.x; i <= bhi.x; ++i) {
+            lb.push_back(ba(i,j,k));
+        }}}
+    }
+
+    const Vector<Real> gb = allGather(lb, m_counts);
+
+    const int n = m_n;
+    Vector<Real> z(n);
+    for (int t = 0; t < n; ++t) {
+        z[m_iperm[m_gids[t]]] = gb[t];
+    }
+    if (Lp.isBottomSingular()) {
+        z[m_iperm[n-1]] = 0.0;
+    }
+
+    if (m_cholesky)
+    {
+        const int kl = m_kl;
+        const int wl = kl + 1;
+        auto L = [&] (int i, int j) -> Real { return m_band[long(i)*wl + (j - i + kl)]; };
+        for (int i = 0; i < n; ++i) {
+            Real s = z[i];
+            for (int j = std::max(0, i-kl); j < i; ++j) s -= L(i,j)*z[j];
+            z[i] = s/L(i,i);
+        }
+        for (int i = n-1; i >= 0; --i) {
+            z[i] /= L(i,i);
+            const Real zi = z[i];
+            for (int j = std::max(0, i-kl); j < i; ++j) z[j] -= L(i,j)*zi;
+        }
+    }
+    else
+    {
+        const int w = m_kl + m_ku + 1;
+        auto B = [&] (int i, int j) -> Real { return m_band[long(i)*w + (j - i + m_kl)]; };
+        for (int i = 0; i < n; ++i) {
+            Real s = z[i];
+            for (int j = std::max(0, i-m_kl); j < i; ++j) s -= B(i,j)*z[j];
+            z[i] = s;
+        }
+        for (int i = n-1; i >= 0; --i) {
+            Real s = z[i];
+            for (int j = i+1; j <= std::min(n-1, i+m_ku); ++j) s -= B(i,j)*z[j];
+            z[i] = s/B(i,i);
+        }
+    }
+
+    // ---- the local unknowns follow those of the lower ranks in the gathers
+    int t = 0;
+    for (int p = 0; p < ParallelContext::MyProcSub(); ++p) {
+        t += m_counts[p];
+    }
+    for (MFIter mfi(x); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.validbox();
+        const auto& xa = x.array(mfi);
+        const Dim3 blo = amrex::lbound(bx);
+        const Dim3 bhi = amrex::ubound(bx);
+        for (int k = blo.z; k <= bhi.z; ++k) {
+        for (int j = blo.y; j <= bhi.y; ++j) {
+        for (int i = blo.x; i <= bhi.x; ++i, ++t) {
+            xa(i,j,k) = z[m_iperm[m_gids[t]]];
+        }}}
+    }
+}
+
+}
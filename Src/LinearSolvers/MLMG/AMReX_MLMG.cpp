@@ -2,6 +2,7 @@
 #include <AMReX_MultiFabUtil.H>
 #include <AMReX_VisMF.H>
 #include <AMReX_MLCGSolver.H>
+#include <AMReX_MLDirectSolver.H>
 #include <AMReX_BC_TYPES.H>
 #include <AMReX_MLMG_F.H>
 #include <AMReX_MLMG_K.H>
@@ -97,6 +98,9 @@ MLMG::solve (const Vector<MultiFab*>& a_sol, const Vector<MultiFab const*>& a_rh
     }
     const Real res_target = std::max(a_tol_abs, std::max(a_tol_rel,1.e-16)*max_norm);
 
+    m_init_resnorm0 = resnorm0;
+    m_iter_fine_resnorm0.clear();
+
     if (!is_nsolve && resnorm0 <= res_target) {
         composite_norminf = resnorm0;
         if (verbose >= 1) {
@@ -119,6 +123,7 @@ MLMG::solve (const Vector<MultiFab*>& a_sol, const Vector<MultiFab const*>& a_rh
             if (is_nsolve) continue;
 
             Real fine_norminf = ResNormInf(finest_amr_lev);
+            m_iter_fine_resnorm0.push_back(fine_norminf);
             composite_norminf = fine_norminf;
             if (verbose >= 2) {
                 amrex::Print() << "MLMG: Iteration " << std::setw(3) << iter+1 << " Fine resid/"
@@ -174,6 +179,8 @@ MLMG::solve (const Vector<MultiFab*>& a_sol, const Vector<MultiFab const*>& a_rh
         }
     }
 
+    m_final_resnorm0 = composite_norminf;
+
     timer[solve_time] = amrex::second() - solve_start_time;
     if (verbose >= 1) {
         ParallelReduce::Max<Real>(timer.data(), timer.size(), 0,
@@ -223,6 +230,8 @@ void MLMG::oneIter (int iter)
 
         if (iter < max_fmg_iters) {
             mgFcycle ();
+        } else if (mixed_precision && linop.supportsFloatCycles()) {
+            mgVcycleF ();
         } else {
             mgVcycle (0, 0);
         }
@@ -374,6 +383,26 @@ std::string make_str (Ts... xs) {
     return oss.str();
 }
 
+// dst = src on the valid cells, converting the precision
+template <class DFAB, class SFAB>
+void copyConvert (FabArray<DFAB>& dst, const FabArray<SFAB>& src, int ncomp)
+{
+    typedef typename DFAB::value_type D;
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(dst,TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+        auto const dfab = dst.array(mfi);
+        auto const sfab = src.array(mfi);
+        AMREX_HOST_DEVICE_FOR_4D ( bx, ncomp, i, j, k, n,
+        {
+            dfab(i,j,k,n) = static_cast<D>(sfab(i,j,k,n));
+        });
+    }
+}
+
 }
 
 // in   : Residual (res) 
@@ -399,7 +428,7 @@ MLMG::mgVcycle (int amrlev, int mglev_top)
 
         cor[amrlev][mglev]->setVal(0.0);
         bool skip_fillboundary = true;
-        for (int i = 0; i < nu1; ++i) {
+        for (int i = 0, n = numSmoothCalls(amrlev, mglev, nu1); i < n; ++i) {
             linop.smooth(amrlev, mglev, *cor[amrlev][mglev], res[amrlev][mglev],
                          skip_fillboundary);
             skip_fillboundary = false;
@@ -448,7 +477,7 @@ MLMG::mgVcycle (int amrlev, int mglev_top)
         }
         cor[amrlev][mglev_bottom]->setVal(0.0);
         bool skip_fillboundary = true;
-        for (int i = 0; i < nu1; ++i) {
+        for (int i = 0, n = numSmoothCalls(amrlev, mglev_bottom, nu1); i < n; ++i) {
             linop.smooth(amrlev, mglev_bottom, *cor[amrlev][mglev_bottom], res[amrlev][mglev_bottom],
                          skip_fillboundary);
             skip_fillboundary = false;
@@ -476,7 +505,7 @@ MLMG::mgVcycle (int amrlev, int mglev_top)
             amrex::Print() << "AT LEVEL "  << amrlev << " " << mglev
                            << "   UP: Norm before smooth " << norm << "\n";
         }
-        for (int i = 0; i < nu2; ++i) {
+        for (int i = 0, n = numSmoothCalls(amrlev, mglev, nu2); i < n; ++i) {
             linop.smooth(amrlev, mglev, *cor[amrlev][mglev], res[amrlev][mglev]);
         }
         if (verbose >= 4)
@@ -489,6 +518,72 @@ MLMG::mgVcycle (int amrlev, int mglev_top)
     }
 }
 
+// V-cycle on the coarsest AMR level with single precision corrections.
+// in   : Residual (res) on MG level 0
+// out  : Correction (cor) on MG level 0
+void
+MLMG::mgVcycleF ()
+{
+    BL_PROFILE("MLMG::mgVcycleF()");
+
+    const int amrlev = 0;
+    const int mglev_bottom = linop.NMGLevels(amrlev) - 1;
+    const int ncomp = linop.getNComp();
+
+    copyConvert(fres[0], res[amrlev][0], ncomp);
+
+    for (int mglev = 0; mglev < mglev_bottom; ++mglev)
+    {
+        fcor[mglev].setVal(0.0f);
+        bool skip_fillboundary = true;
+        for (int i = 0; i < nu1; ++i) {
+            linop.smoothF(amrlev, mglev, fcor[mglev], fres[mglev], skip_fillboundary);
+            skip_fillboundary = false;
+        }
+
+        // rescor = res - L(cor)
+        linop.correctionResidualF(amrlev, mglev, frescor[mglev], fcor[mglev], fres[mglev]);
+
+        // res_crse = R(rescor_fine)
+        linop.restrictionF(amrlev, mglev+1, fres[mglev+1], frescor[mglev]);
+    }
+
+    // the bottom solvers work in double precision on res of the bottom,
+    // which is swapped out for bottom_res so that it is kept when it is
+    // the residual res[0][0] of the cycle
+    BL_PROFILE_VAR("MLMG::mgVcycle_bottom", blp_bottom);
+    copyConvert(bottom_res, fres[mglev_bottom], ncomp);
+    std::swap(bottom_res, res[amrlev][mglev_bottom]);
+    bottomSolve();
+    std::swap(bottom_res, res[amrlev][mglev_bottom]);
+    copyConvert(fcor[mglev_bottom], *cor[amrlev][mglev_bottom], ncomp);
+    BL_PROFILE_VAR_STOP(blp_bottom);
+
+    for (int mglev = mglev_bottom-1; mglev >= 0; --mglev)
+    {
+        // cor_fine += I(cor_crse), as in addInterpCorrection
+        const MLLinOp::fMultiFab& crse_cor = fcor[mglev+1];
+        MLLinOp::fMultiFab&       fine_cor = fcor[mglev  ];
+        BoxArray cba = fine_cor.boxArray();
+        cba.coarsen(MLLinOp::mg_coarsen_ratio);
+        MLLinOp::fMultiFab cfine;
+        const MLLinOp::fMultiFab* cmf = &crse_cor;
+        if (cba != crse_cor.boxArray() || fine_cor.DistributionMap() != crse_cor.DistributionMap())
+        {
+            cfine.define(cba, fine_cor.DistributionMap(), ncomp, 0);
+            cfine.ParallelCopy(crse_cor);
+            cmf = &cfine;
+        }
+        linop.interpolationF(amrlev, mglev, fine_cor, *cmf);
+
+        for (int i = 0; i < nu2; ++i) {
+            linop.smoothF(amrlev, mglev, fine_cor, fres[mglev]);
+        }
+    }
+
+    copyConvert(*cor[amrlev][0], fcor[0], ncomp);
+}
+
 // FMG cycle on the coarsest AMR level.
 // in:  Residual on the top MG level (i.e., 0)
 // out: Correction (cor) on all MG levels
@@ -805,6 +900,40 @@ MLMG::computeResOfCorrection (int amrlev, int mglev)
     linop.correctionResidual(amrlev, mglev, r, x, b, BCMode::Homogeneous);
 }
 
+void
+MLMG::setMixedPrecision (bool flag)
+{
+    mixed_precision = flag;
+    if (!flag) {
+        fcor.clear();
+        fres.clear();
+        frescor.clear();
+        bottom_res.clear();
+    }
+}
+
+void
+MLMG::setBottomSStep (int s)
+{
+    if (s < 1 || s > MLCGSolver::max_sstep) {
+        amrex::Abort("MLMG: the bottom s-step must be between 1 and "
+                     + std::to_string(MLCGSolver::max_sstep));
+    }
+    bottom_sstep = s;
+}
+
+int
+MLMG::numSmoothCalls (int amrlev, int mglev, int nu) const
+{
+    const int nsweeps = linop.sweepsPerSmooth(amrlev, mglev);
+    if (nu % nsweeps != 0) {
+        amrex::Abort("MLMG: the number of smoothing sweeps " + std::to_string(nu)
+                     + " is not a multiple of the " + std::to_string(nsweeps)
+                     + " sweeps of one smooth call on MG level " + std::to_string(mglev));
+    }
+    return nu / nsweeps;
+}
+
 // At the true bottom of the coarset AMR level.
 // in  : Residual (res) as b
 // out : Correction (cor) as x
@@ -860,7 +989,7 @@ MLMG::actualBottomSolve ()
     {
 
       bool skip_fillboundary = true;
-        for (int i = 0; i < nuf; ++i) {
+        for (int i = 0, n = numSmoothCalls(amrlev, mglev, nuf); i < n; ++i) {
             linop.smooth(amrlev, mglev, x, b, skip_fillboundary);
             skip_fillboundary = false;
         }
@@ -887,16 +1016,28 @@ MLMG::actualBottomSolve ()
         {
             bottomSolveWithPETSc(x, *bottom_b);
         }
+        else if (bottom_solver == BottomSolver::direct && setupDirectSolver())
+        {
+            bottomSolveWithDirect(x, *bottom_b);
+        }
         else
         {
+            // BiCGStab also stands in for a direct solver whose band is too large
             MLCGSolver cg_solver(this, linop);
             if (bottom_solver == BottomSolver::bicgstab) {
                 cg_solver.setSolver(MLCGSolver::Type::BiCGStab);
             } else if (bottom_solver == BottomSolver::cg) {
                 cg_solver.setSolver(MLCGSolver::Type::CG);
+            } else if (bottom_solver == BottomSolver::pipelined_bicgstab) {
+                cg_solver.setSolver(MLCGSolver::Type::PipelinedBiCGStab);
+            } else if (bottom_solver == BottomSolver::pipelined_cg) {
+                cg_solver.setSolver(MLCGSolver::Type::PipelinedCG);
+            } else if (bottom_solver == BottomSolver::sstep_cg) {
+                cg_solver.setSolver(MLCGSolver::Type::SStepCG);
             }
             cg_solver.setVerbose(bottom_verbose);
             cg_solver.setMaxIter(bottom_maxiter);
+            cg_solver.setSStep(bottom_sstep);
             
             const Real cg_rtol = bottom_reltol;
             const Real cg_atol = -1.0;
@@ -907,7 +1048,7 @@ MLMG::actualBottomSolve ()
             // If the MLMG solve failed then set the correction to zero 
             if (ret != 0)
                 cor[amrlev][mglev]->setVal(0.0);
-            const int n = ret==0 ? nub : nuf;
+            const int n = numSmoothCalls(amrlev, mglev, ret==0 ? nub : nuf);
             for (int i = 0; i < n; ++i) {
                 linop.smooth(amrlev, mglev, x, b);
             }
@@ -1074,6 +1215,8 @@ MLMG::prepareForSolve (const Vector<MultiFab*>& a_sol, const Vector<MultiFab con
     petsc_bndry.reset(); 
 #endif
 
+    direct_solver_ready = false;
+
     sol.resize(namrlevs);
     sol_raii.resize(namrlevs);
     for (int alev = 0; alev < namrlevs; ++alev)
@@ -1160,6 +1303,26 @@ MLMG::prepareForSolve (const Vector<MultiFab*>& a_sol, const Vector<MultiFab con
         }
     }
 
+    if (mixed_precision && linop.supportsFloatCycles() && fcor.empty())
+    {
+        const int alev = 0;
+        const int nmglevs = linop.NMGLevels(alev);
+        fcor.resize(nmglevs);
+        fres.resize(nmglevs);
+        frescor.resize(nmglevs);
+        for (int mglev = 0; mglev < nmglevs; ++mglev)
+        {
+            const BoxArray& ba = res[alev][mglev].boxArray();
+            const DistributionMapping& dm = res[alev][mglev].DistributionMap();
+            fcor   [mglev].define(ba, dm, ncomp, ng);
+            fres   [mglev].define(ba, dm, ncomp, 0);
+            frescor[mglev].define(ba, dm, ncomp, 0);
+        }
+        const MultiFab& bres = res[alev][nmglevs-1];
+        bottom_res.define(bres.boxArray(), bres.DistributionMap(), ncomp, bres.nGrow(),
+                          MFInfo(), *linop.Factory(alev,nmglevs-1));
+    }
+
     cor_hold.resize(std::max(namrlevs-1,1));
     {
         const int alev = 0;
@@ -1696,6 +1859,31 @@ MLMG::bottomSolveWithHypre (MultiFab& x, const MultiFab& b)
 #endif
 }
 
+bool
+MLMG::setupDirectSolver ()
+{
+    if (direct_solver == nullptr)
+    {
+        direct_solver.reset(new MLDirectSolver(linop));
+        direct_solver->setVerbose(bottom_verbose);
+    }
+
+    if (!direct_solver_ready)
+    {
+        direct_solver->setMaxBandBytes(direct_max_band_bytes);
+        direct_solver_ok = direct_solver->setup();
+        direct_solver_ready = true;
+    }
+
+    return direct_solver_ok;
+}
+
+void
+MLMG::bottomSolveWithDirect (MultiFab& x, const MultiFab& b)
+{
+    direct_solver->solve(x, b);
+}
+
 void
 MLMG::bottomSolveWithPETSc (MultiFab& x, const MultiFab& b)
 {
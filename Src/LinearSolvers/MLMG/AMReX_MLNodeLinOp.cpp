@@ -173,12 +173,19 @@ MLNodeLinOp::smooth (int amrlev, int mglev, MultiFab& sol, const MultiFab& rhs,
     Fsmooth(amrlev, mglev, sol, rhs);
 }
 
-Real
-MLNodeLinOp::xdoty (int amrlev, int mglev, const MultiFab& x, const MultiFab& y, bool local) const
+const MultiFab*
+MLNodeLinOp::dotWeights (int amrlev, int mglev) const
 {
     AMREX_ASSERT(amrlev==0);
     AMREX_ASSERT(mglev+1==m_num_mg_levels[0] || mglev==0);
-    const auto& mask = (mglev+1 == m_num_mg_levels[0]) ? m_bottom_dot_mask : m_coarse_dot_mask;
+    amrex::ignore_unused(amrlev);
+    return (mglev+1 == m_num_mg_levels[0]) ? &m_bottom_dot_mask : &m_coarse_dot_mask;
+}
+
+Real
+MLNodeLinOp::xdoty (int amrlev, int mglev, const MultiFab& x, const MultiFab& y, bool local) const
+{
+    const MultiFab& mask = *dotWeights(amrlev, mglev);
     const int ncomp = y.nComp();
     const int nghost = 0;
     MultiFab tmp(x.boxArray(), x.DistributionMap(), ncomp, 0);
@@ -14,32 +14,75 @@
 #include <AMReX_Utility.H>
 #include <AMReX_Cluster.H>
 #include <AMReX_BCUtil.H>
+#include <AMReX_FillPatchUtil.H>
+#include <AMReX_Interpolater.H>
 
 #include "Lithium_F.H"
 #include "Lithium.H"
 
 using namespace amrex;
 
+namespace {
+    // li.bottom_solver: 0 bicgstab, 1 cg, 2 pipelined bicgstab, 3 pipelined cg, 4 s-step cg, 5 direct
+    const MLMG::BottomSolver bottom_solvers[] = { MLMG::BottomSolver::bicgstab,
+                                                  MLMG::BottomSolver::cg,
+                                                  MLMG::BottomSolver::pipelined_bicgstab,
+                                                  MLMG::BottomSolver::pipelined_cg,
+                                                  MLMG::BottomSolver::sstep_cg,
+                                                  MLMG::BottomSolver::direct };
+}
+
 Lithium::Lithium()
 {       
     ReadParameters();
     ResizeLevelList();   
     InitData();
 
-    WritePlotFile();
+    if (restart_file.empty()) {
+        WritePlotFile();
+    }
 
     istep[0] += 1;
     // UpdatePotential();
 
-    for (; istep[0] <= max_step; istep[0]++)
+    bool last_step = false;
+    for (; istep[0] <= max_step && !last_step; istep[0]++)
     {   
-        UpdatePhi();
-        if (istep[0] % update_pot_interval == 0 ) {
-            UpdatePotential();
+        if (max_level > 0 && regrid_int > 0 && istep[0] % regrid_int == 0)
+        {
+            regrid(0, t_new[0]);
+        }
+
+        ComputeDt();
+        last_step = (t_new[0] + dt >= stop_time * (1.0 - 1.e-12)) || istep[0] == max_step;
+
+        for (int lev = 0; lev <= finest_level; lev++)
+        {
+            t_old[lev] = t_new[lev];
+            t_new[lev] += dt;
+            istep[lev] = istep[0];
         }
-        UpdateSolute();
 
-        if ((istep[0] % plot_step == 0 && istep[0] > start_write_plotfile) || (istep[0] == 1))
+        if (implicit_solute) {
+            UpdatePhi();
+            if (PotentialNeedsUpdate()) {
+                UpdatePotential();
+            }
+            UpdateSoluteImplicit();
+        } else if (fused_update) {
+            UpdatePhiSolute();
+            if (PotentialNeedsUpdate()) {
+                UpdatePotential();
+            }
+        } else {
+            UpdatePhi();
+            if (PotentialNeedsUpdate()) {
+                UpdatePotential();
+            }
+            UpdateSolute();
+        }
+
+        if ((istep[0] % plot_step == 0 && istep[0] > start_write_plotfile) || (istep[0] == 1) || last_step)
         {
             WritePlotFile();
         }
@@ -48,43 +91,122 @@ Lithium::Lithium()
         {
             ChangeVoltage();
         }
+
+        if (chk_step > 0 && (istep[0] % chk_step == 0 || last_step))
+        {
+            WriteCheckpointFile();
+        }
     }
+
+    WaitPlotFile();
+    WaitCheckpointFile();
 }
 
 
-void Lithium::UpdatePotential()
-{   
-    const int nlevels = geom.size();
-       
+std::unique_ptr<MLABecLaplacian> Lithium::BuildABecOperator() const
+{
     LPInfo info;
     info.setAgglomeration(agglomeration);
     info.setConsolidation(consolidation);
     info.setMaxCoarseningLevel(max_coarsening_level);
 
-    MLABecLaplacian mlabec(geom, grids, dmap, info);
-
-    mlabec.setMaxOrder(linop_maxorder);
+    // one amr level per existing level, the levels above finest_level are empty
+    const int nlevs = finest_level + 1;
+    std::unique_ptr<MLABecLaplacian> op(
+        new MLABecLaplacian(Vector<Geometry>           (geom.begin(),  geom.begin() + nlevs),
+                            Vector<BoxArray>           (grids.begin(), grids.begin() + nlevs),
+                            Vector<DistributionMapping>(dmap.begin(),  dmap.begin() + nlevs),
+                            info));
+
+    op->setMaxOrder(linop_maxorder);
+    if (mg_smoother == 1) {
+        op->setSmoother(MLABecLaplacian::Smoother::Chebyshev, mg_cheby_degree);
+    }
+    op->setSweepsPerExchange(mg_sweeps_per_exchange, mg_wide_min_level);
+    op->setPackedStencil(mg_packed_stencil);
+    op->setIncrementalUpdate(mg_incremental_coeffs);
     
-    mlabec.setDomainBC({AMREX_D_DECL(LinOpBCType::Dirichlet,
-                                LinOpBCType::Neumann,
-                                LinOpBCType::Neumann)},
-                    {AMREX_D_DECL(LinOpBCType::Dirichlet,
-                                LinOpBCType::Neumann,
-                                LinOpBCType::Neumann)});
-    for (int lev = 0; lev <= max_level; ++lev)
+    op->setDomainBC({AMREX_D_DECL(LinOpBCType::Dirichlet,
+                            LinOpBCType::Neumann,
+                            LinOpBCType::Neumann)},
+                {AMREX_D_DECL(LinOpBCType::Dirichlet,
+                            LinOpBCType::Neumann,
+                            LinOpBCType::Neumann)});
+    return op;
+}
+
+void Lithium::BuildPotentialSolver()
+{
+    mlabec = BuildABecOperator();
+    mlabec->setScalars(ascalar, bscalar);
+
+    mlmg.reset(new MLMG(*mlabec));
+    SetSolverOptions(*mlmg);
+}
+
+void Lithium::SetSolverOptions(MLMG& solver) const
+{
+    solver.setMaxIter(max_iter);
+    solver.setMaxFmgIter(max_fmg_iter);
+    solver.setVerbose(verbose);
+    solver.setBottomVerbose(bottom_verbose);
+    solver.setBottomTolerance(tol_bottom);
+    solver.setBottomSolver(bottom_solvers[bottom_solver]);
+    solver.setBottomSStep(bottom_sstep);
+    solver.setMixedPrecision(mg_mixed_precision);
+    // solver.setBottomSolver(MLMG::BottomSolver::smoother);
+#ifdef AMREX_USE_HYPRE
+            if (use_hypre) {
+                solver.setBottomSolver(MLMG::BottomSolver::hypre);
+                solver.setHypreInterface(hypre_interface);
+            }
+#endif
+}
+
+void Lithium::ClearPotentialSolver()
+{
+    mlmg.reset();
+    mlabec.reset();
+}
+
+void Lithium::ClearSolvers()
+{
+    ClearPotentialSolver();
+    solute_mlmg.reset();
+    solute_mlabec.reset();
+}
+
+void Lithium::BuildSoluteSolver()
+{
+    solute_mlabec = BuildABecOperator();
+
+    solute_mlmg.reset(new MLMG(*solute_mlabec));
+    SetSolverOptions(*solute_mlmg);
+}
+
+void Lithium::UpdatePotential()
+{   
+    // the operator hierarchy only depends on the grids, with persistent_solver
+    // it is kept between calls and only the coefficients, BC and rhs change
+    if (!persistent_solver || !mlabec) {
+        BuildPotentialSolver();
+    }
+
+    for (int lev = 0; lev <= finest_level; ++lev)
     { 
-        FillDirechletBoundary(potential[lev], geom[lev], bc, bc_val_potential);
-        mlabec.setLevelBC(lev, &potential[lev]);
+        FillGhost(lev, potential, bc_val_potential);
+        mlabec->setLevelBC(lev, &potential[lev]);
     }
     
-    mlabec.setScalars(ascalar, bscalar);
-    
-    for (int lev = 0; lev <= max_level; ++lev)
+    for (int lev = 0; lev <= finest_level; ++lev)
     {
-        FillDirechletBoundary(phi[lev], geom[lev], bc, bc_val_phi);
-        for (MFIter mfi(phi[lev]); mfi.isValid(); ++mfi)
+        FillGhost(lev, phi, bc_val_phi);
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(phi[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
         {
-            const Box &bx = mfi.validbox();
+            const Box &bx = mfi.growntilebox();
         
             init_bcoef(BL_TO_FORTRAN_BOX(bx),
                     BL_TO_FORTRAN_ANYD(bcoef[lev][mfi]),
@@ -106,60 +228,156 @@ void Lithium::UpdatePotential()
 
         for (int idim = 0; idim < AMREX_SPACEDIM; ++idim)
         {
-            face_bcoef[idim].FillBoundary(geom[0].periodicity());
+            face_bcoef[idim].FillBoundary(geom[lev].periodicity());
         }
         
-        mlabec.setBCoeffs(lev, amrex::GetArrOfConstPtrs(face_bcoef));
+        mlabec->setBCoeffs(lev, amrex::GetArrOfConstPtrs(face_bcoef));
         phi_dt[lev].FillBoundary();
         MultiFab::Copy(rhs[lev], phi_dt[lev], 0, 0, 1, 0);
         rhs[lev].mult(fara_cs);
     }
 
-    MLMG mlmg(mlabec);
-    mlmg.setMaxIter(max_iter);
-    mlmg.setMaxFmgIter(max_fmg_iter);
-    mlmg.setVerbose(verbose);
-    mlmg.setBottomVerbose(bottom_verbose);
-    mlmg.setFixedIter(fix_inter);
-    mlmg.setBottomTolerance(tol_bottom);
-    // mlmg.setBottomSolver(MLMG::BottomSolver::smoother);
-#ifdef AMREX_USE_HYPRE
-            if (use_hypre) {
-                mlmg.setBottomSolver(MLMG::BottomSolver::hypre);
-                mlmg.setHypreInterface(hypre_interface);
-            }
-#endif
-
     if (first_step_flag){
-        mlmg.setFixedIter(30);
-        mlmg.solve(GetVecOfPtrs(potential), GetVecOfConstPtrs(rhs), 1e-20, 0);  
+        mlmg->setFixedIter(30);
+        mlmg->solve(GetVecOfPtrs(potential), GetVecOfConstPtrs(rhs), 1e-20, 0);  
         first_step_flag = false;  
 
+    } else if (adaptive_potential) {
+        // warm start from the last potential and iterate to the tolerance
+        mlmg->setFixedIter(0);
+        mlmg->solve(GetVecOfPtrs(potential), GetVecOfConstPtrs(rhs), tol_rel, tol_abs);
+
     } else {
-        mlmg.solve(GetVecOfPtrs(potential), GetVecOfConstPtrs(rhs), tol_rel, tol_abs);    
+        mlmg->setFixedIter(fix_inter);
+        mlmg->solve(GetVecOfPtrs(potential), GetVecOfConstPtrs(rhs), tol_rel, tol_abs);    
     }
 
-    // mlmg.getGradSolution(amrex::GetVecOfArrOfPtrs(grad));
+    // mlmg->getGradSolution(amrex::GetVecOfArrOfPtrs(grad));
+    AverageDown(potential);
+
+    if (adaptive_potential)
+    {
+        // the solve already knows its residual, no extra residual pass
+        error_norm = mlmg->getFinalResidual();
+
+        if (verbose > 0)
+        {
+            amrex::Print() << "Potential solve at step " << istep[0]
+                           << " after " << istep[0] - pot_last_step << " steps"
+                           << " (phi_dt change " << pot_rhs_change
+                           << ", phi change " << pot_phi_change << "): "
+                           << mlmg->getNumIters() << " iterations, residual "
+                           << mlmg->getInitResidual() << " -> " << error_norm << "\n";
+            amrex::Print() << "  residual history:";
+            for (Real r : mlmg->getResidualHistory()) {
+                amrex::Print() << " " << r;
+            }
+            amrex::Print() << "\n";
+        }
 
-    mlmg.compResidual(GetVecOfPtrs(error), GetVecOfPtrs(potential), GetVecOfConstPtrs(rhs));
-    error_norm = error[0].norm0();
+        pot_last_step = istep[0];
+        SavePotentialState();
+    }
+    else
+    {
+        mlmg->compResidual(GetVecOfPtrs(error), GetVecOfPtrs(potential), GetVecOfConstPtrs(rhs));
+        error_norm = error[0].norm0();
+    }
     AMREX_ALWAYS_ASSERT(error_norm < 1.0);
+
+    if (!persistent_solver) {
+        ClearPotentialSolver();
+    }
+}
+
+bool Lithium::PotentialNeedsUpdate()
+{
+    if (!adaptive_potential) {
+        return istep[0] % update_pot_interval == 0;
+    }
+
+    if (first_step_flag || pot_phi.empty() || istep[0] - pot_last_step >= update_pot_interval) {
+        pot_rhs_change = pot_phi_change = 0.0;
+        return true;
+    }
+
+    // max change since the last solve, on the levels whose grids did not change
+    // since then; level 0 always qualifies and carries the averaged fine data
+    Real drhs = 0.0, dphi = 0.0, rhs_max = 0.0;
+    for (int lev = 0; lev <= finest_level && lev < pot_phi.size(); ++lev)
+    {
+        if (!PotentialStateOnGrids(lev)) {
+            continue;
+        }
+        rhs_max = std::max(rhs_max, pot_phi_dt[lev].norm0(0, 0, true));
+#ifdef _OPENMP
+#pragma omp parallel reduction(max:drhs,dphi) if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(phi[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.tilebox();
+            max_abs_diff(BL_TO_FORTRAN_BOX(bx),
+                         BL_TO_FORTRAN_ANYD(phi_dt[lev][mfi]),
+                         BL_TO_FORTRAN_ANYD(pot_phi_dt[lev][mfi]),
+                         &drhs);
+            max_abs_diff(BL_TO_FORTRAN_BOX(bx),
+                         BL_TO_FORTRAN_ANYD(phi[lev][mfi]),
+                         BL_TO_FORTRAN_ANYD(pot_phi[lev][mfi]),
+                         &dphi);
+        }
+    }
+    ParallelDescriptor::ReduceRealMax({drhs, dphi, rhs_max});
+
+    pot_rhs_change = (rhs_max > 0.0) ? drhs / rhs_max : drhs;
+    pot_phi_change = dphi;
+
+    return pot_rhs_change > pot_rhs_tol || pot_phi_change > pot_phi_tol;
+}
+
+bool Lithium::PotentialStateOnGrids(int lev) const
+{
+    return lev < pot_phi.size() && !pot_phi[lev].empty()
+        && pot_phi[lev].boxArray() == grids[lev] && pot_phi[lev].DistributionMap() == dmap[lev];
+}
+
+void Lithium::SavePotentialState()
+{
+    pot_phi.resize(finest_level + 1);
+    pot_phi_dt.resize(finest_level + 1);
+    for (int lev = 0; lev <= finest_level; ++lev)
+    {
+        if (pot_phi[lev].boxArray() != grids[lev] || pot_phi[lev].DistributionMap() != dmap[lev])
+        {
+            pot_phi[lev].define(grids[lev], dmap[lev], 1, 0);
+            pot_phi_dt[lev].define(grids[lev], dmap[lev], 1, 0);
+        }
+        MultiFab::Copy(pot_phi[lev], phi[lev], 0, 0, 1, 0);
+        MultiFab::Copy(pot_phi_dt[lev], phi_dt[lev], 0, 0, 1, 0);
+    }
 }
 
 void Lithium::UpdatePhi()
 {   
-
-    for (int lev = 0; lev <= max_level; lev++){
+    // from the finest level down, so that the coarse/fine ghost cells are
+    // interpolated from the coarse data of the same time
+    for (int lev = finest_level; lev >= 0; lev--){
         const Box& domain_box = geom[lev].Domain();
-        FillDirechletBoundary(phi[lev], geom[lev], bc, bc_val_phi);
-        FillDirechletBoundary(potential[lev], geom[lev], bc, bc_val_potential);
-        FillDirechletBoundary(solute[lev] , geom[lev], bc, bc_val_solute);
+        const bool overlap = overlap_comm && lev == 0 && Gpu::notInLaunchRegion();
+        if (overlap) {
+            FillStateBoundary_nowait(lev);
+        } else {
+            FillStateBoundary(lev);
+        }
 
-        phi_dt[lev].FillBoundary(geom[lev].periodicity());
-        
-        for (MFIter mfi(phi[lev]); mfi.isValid(); ++mfi)
+        if (persistent_fb && lev == 0) {
+            phi_dt[lev].FillBoundaryPersistent(geom[lev].periodicity());
+        } else {
+            phi_dt[lev].FillBoundary(geom[lev].periodicity());
+        }
+
+        auto phase_field = [&] (const MFIter& mfi)
         {
-            const Box& bx = mfi.validbox();
+            const Box& bx = mfi.tilebox();
             advance_phase_field(
                 BL_TO_FORTRAN_BOX(bx),
                 BL_TO_FORTRAN_BOX(domain_box),
@@ -176,28 +394,71 @@ void Lithium::UpdatePhi()
                 & itf_mobi,
                 & nFRT,
                 & alpha_asy,
-                & voltage
+                & voltage,
+                & noise_amp
             );
+        };
+
+        if (overlap)
+        {
+            // the interior of the boxes needs no ghost cells of the state,
+            // the rim is done once the exchange is finished
+            const IntVect ng = phi[lev].nGrowVect();
+            auto progress = [&] () {
+                phi      [lev].FillBoundary_test();
+                solute   [lev].FillBoundary_test();
+                potential[lev].FillBoundary_test();
+            };
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+            for (MFOverlapIter mfi(phi[lev], MFOverlapIter::Inner, ng, progress); mfi.isValid(); ++mfi)
+            {
+                phase_field(mfi);
+            }
+
+            FillStateBoundary_finish(lev);
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+            for (MFOverlapIter mfi(phi[lev], MFOverlapIter::Rim, ng); mfi.isValid(); ++mfi)
+            {
+                phase_field(mfi);
+            }
+        }
+        else
+        {
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+            for (MFIter mfi(phi[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
+            {
+                phase_field(mfi);
+            }
         }
         std::swap(phi[lev], phi_new[lev]);
     }
+    AverageDown(phi);
+    AverageDown(phi_dt);
 }
 
 
 void Lithium::UpdateSolute()
 {
     
-    for (int lev = 0; lev <= max_level; lev++){
+    for (int lev = finest_level; lev >= 0; lev--){
         
-        FillDirechletBoundary(phi[lev], geom[lev], bc, bc_val_phi);
-        FillDirechletBoundary(potential[lev] , geom[lev], bc, bc_val_potential);
-        FillDirechletBoundary(solute[lev] , geom[lev], bc, bc_val_solute);
+        FillStateBoundary(lev);
 
         const Box& domain_box = geom[lev].Domain();
 
-        for (MFIter mfi(solute[lev]); mfi.isValid(); ++mfi)
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(solute[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
         {
-            const Box& bx = mfi.validbox();
+            const Box& bx = mfi.tilebox();
             advance_solute(
                 BL_TO_FORTRAN_BOX(bx),
                 BL_TO_FORTRAN_BOX(domain_box),
@@ -220,16 +481,248 @@ void Lithium::UpdateSolute()
         AMREX_ALWAYS_ASSERT(solute[lev].min(0) >= 0.0);
 
     }
+    AverageDown(solute);
+}
+
+void Lithium::UpdateSoluteImplicit()
+{
+    if (!persistent_solver || !solute_mlabec) {
+        BuildSoluteSolver();
+    }
+
+    // (a - dt div(b grad)) u = rhs in the Slotboom variable u = c / a, see solute_implicit_setup;
+    // u goes to solute_new, whose ghost cells carry the direchlet values of u
+    const int nlevs = finest_level + 1;
+    Vector<MultiFab> slot_acoef(nlevs), slot_bcoef(nlevs), slot_rhs(nlevs);
+
+    solute_mlabec->setScalars(1.0, dt);
+
+    for (int lev = 0; lev <= finest_level; ++lev)
+    {
+        FillStateBoundary(lev);
+
+        slot_acoef[lev].define(grids[lev], dmap[lev], 1, 1);
+        slot_bcoef[lev].define(grids[lev], dmap[lev], 1, 1);
+        slot_rhs  [lev].define(grids[lev], dmap[lev], 1, 0);
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(solute[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& bx  = mfi.tilebox();
+            const Box& gbx = mfi.growntilebox();
+            solute_implicit_setup(
+                BL_TO_FORTRAN_BOX(gbx),
+                BL_TO_FORTRAN_BOX(bx),
+                BL_TO_FORTRAN_ANYD(phi[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(phi_dt[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(solute[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(potential[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(slot_acoef[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(slot_bcoef[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(solute_new[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(slot_rhs[lev][mfi]),
+                & dt,
+                & diff_sld,
+                & diff_liq,
+                & nFRT
+            );
+        }
+
+        Array<MultiFab,AMREX_SPACEDIM> face_bcoef;
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim)
+        {
+            const BoxArray& ba = amrex::convert(slot_bcoef[lev].boxArray(),
+                                                IntVect::TheDimensionVector(idim));
+            face_bcoef[idim].define(ba, slot_bcoef[lev].DistributionMap(), 1, 0);
+        }
+        amrex::average_cellcenter_to_face(GetArrOfPtrs(face_bcoef), slot_bcoef[lev], geom[lev]);
+
+        solute_mlabec->setACoeffs(lev, slot_acoef[lev]);
+        solute_mlabec->setBCoeffs(lev, amrex::GetArrOfConstPtrs(face_bcoef));
+        solute_mlabec->setLevelBC(lev, &solute_new[lev]);
+    }
+
+    solute_mlmg->solve(GetVecOfPtrs(solute_new), GetVecOfConstPtrs(slot_rhs), solute_tol_rel, 0.0);
+
+    for (int lev = 0; lev <= finest_level; ++lev)
+    {
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(solute[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.tilebox();
+            solute_implicit_finish(
+                BL_TO_FORTRAN_BOX(bx),
+                BL_TO_FORTRAN_ANYD(solute[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(slot_acoef[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(solute_new[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(output[lev][mfi])
+            );
+        }
+        std::swap(solute[lev], solute_new[lev]);
+        AMREX_ALWAYS_ASSERT(solute[lev].min(0) >= 0.0);
+    }
+    AverageDown(solute);
+
+    if (!persistent_solver) {
+        solute_mlmg.reset();
+        solute_mlabec.reset();
+    }
+}
+
+void Lithium::UpdatePhiSolute()
+{
+    for (int lev = finest_level; lev >= 0; lev--){
+        const Box& domain_box = geom[lev].Domain();
+        FillStateBoundary(lev);
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(phi[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.tilebox();
+            advance_phi_solute(
+                BL_TO_FORTRAN_BOX(bx),
+                BL_TO_FORTRAN_BOX(domain_box),
+                BL_TO_FORTRAN_ANYD(phi[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(solute[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(potential[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(phi_dt[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(phi_new[lev][mfi]),
+                BL_TO_FORTRAN_ANYD(solute_new[lev][mfi]),
+                geom[lev].CellSize(),
+                & dt,
+                bc[0].data(),
+                & itf_thickness,
+                & itf_mobi,
+                & nFRT,
+                & alpha_asy,
+                & diff_sld,
+                & diff_liq,
+                & noise_amp
+            );
+        }
+        std::swap(phi[lev], phi_new[lev]);
+        std::swap(solute[lev], solute_new[lev]);
+        AMREX_ALWAYS_ASSERT(solute[lev].min(0) >= 0.0);
+    }
+    AverageDown(phi);
+    AverageDown(phi_dt);
+    AverageDown(solute);
+}
+
+void Lithium::ComputeDt()
+{
+    if (adaptive_dt)
+    {
+        // one reduction for all levels, every level advances with the same dt
+        Real dt_est = std::numeric_limits<Real>::max();
+        for (int lev = 0; lev <= finest_level; lev++)
+        {
+            dt_est = std::min(dt_est, EstTimeStep(lev));
+        }
+        ParallelDescriptor::ReduceRealMin(dt_est);
+        dt_est *= cfl;
+
+        if (istep[0] == 1)
+        {
+            dt_est = std::min(dt_est, dt_init);
+        }
+        else
+        {
+            dt_est = std::min(dt_est, dt * dt_change_max);
+
+            // a limiter on the change of phi per step, from the rate of the
+            // last step held in phi_dt; it is not an estimate of the error
+            if (dphi_max > 0.0)
+            {
+                Real rate_max = 0.0;
+                for (int lev = 0; lev <= finest_level; lev++)
+                {
+                    rate_max = std::max(rate_max, phi_dt[lev].norm0(0, 0, true));
+                }
+                ParallelDescriptor::ReduceRealMax(rate_max);
+                if (rate_max > 0.0)
+                {
+                    dt_est = std::min(dt_est, dphi_max / rate_max);
+                }
+            }
+        }
+        dt = dt_est;
+    }
+
+    // don't step past stop_time
+    if (t_new[0] + dt > stop_time)
+    {
+        dt = stop_time - t_new[0];
+    }
+}
+
+Real Lithium::EstTimeStep(int lev)
+{
+    // the ghost cells left by the last step are stale, phi has been swapped with
+    // phi_new; est_timestep reads those between the boxes and extrapolates across
+    // the domain faces, so the physical boundary need not be filled on level 0
+    if (lev == 0) {
+        const Periodicity& period = geom[lev].periodicity();
+        phi      [lev].FillBoundary_nowait(period);
+        potential[lev].FillBoundary_nowait(period);
+        phi      [lev].FillBoundary_finish();
+        potential[lev].FillBoundary_finish();
+    } else {
+        FillGhost(lev, phi,       bc_val_phi);
+        FillGhost(lev, potential, bc_val_potential);
+    }
+
+    Real dt_est = std::numeric_limits<Real>::max();
+
+    const Box& domain_box = geom[lev].Domain();
+
+    // the implicit solute step has no diffusion limit
+    const Real diff_sld_lim = implicit_solute ? 0.0 : diff_sld;
+    const Real diff_liq_lim = implicit_solute ? 0.0 : diff_liq;
+
+#ifdef _OPENMP
+#pragma omp parallel reduction(min:dt_est) if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(phi[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+        est_timestep(BL_TO_FORTRAN_BOX(bx),
+            BL_TO_FORTRAN_BOX(domain_box),
+            BL_TO_FORTRAN_ANYD(phi[lev][mfi]),
+            BL_TO_FORTRAN_ANYD(potential[lev][mfi]),
+            BL_TO_FORTRAN_ANYD(solute[lev][mfi]),
+            geom[lev].CellSize(),
+            bc[0].data(),
+            & diff_sld_lim,
+            & diff_liq_lim,
+            & itf_mobi,
+            & itf_thickness,
+            & nFRT,
+            & alpha_asy,
+            & dt_est
+        );
+    }
+
+    return dt_est;
 }
 
 void Lithium::FillPhyBndDir(Vector<MultiFab>& mf, int dir, Real bc_val)
 {
-    for (int lev = 0; lev <= max_level; lev++){
+    for (int lev = 0; lev <= finest_level; lev++){
         const Box& domain_box = geom[lev].Domain();
 
-        for (MFIter mfi(mf[lev]); mfi.isValid(); ++mfi)
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(mf[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
         {
-            const Box& bx = mfi.validbox();
+            const Box& bx = mfi.tilebox();
 
             fill_physical_boundary_dir(BL_TO_FORTRAN_BOX(bx),
                 BL_TO_FORTRAN_BOX(domain_box),
@@ -259,11 +752,114 @@ void Lithium::FillDirechletBoundary (MultiFab& mf, const Geometry& geom, const V
 {
     if (Geometry::isAllPeriodic()) return;
     if (mf.nGrow() == 0) return;
-    AMREX_ALWAYS_ASSERT(mf.ixType().cellCentered());
-    AMREX_ALWAYS_ASSERT(mf.nComp() >= nComp + 1);
     mf.FillBoundary(geom.periodicity());
+    FillPhysicalBoundary(mf, geom, bc, bc_val, nComp);
+}
+
+void Lithium::FillStateBoundary (int lev)
+{
+    if (lev > 0) {
+        FillGhost(lev, phi,       bc_val_phi);
+        FillGhost(lev, solute,    bc_val_solute);
+        FillGhost(lev, potential, bc_val_potential);
+        return;
+    }
+    if (Geometry::isAllPeriodic()) return;
+    const Periodicity& period = geom[lev].periodicity();
+
+    if (persistent_fb) {
+        phi      [lev].FillBoundaryPersistent(period);
+        solute   [lev].FillBoundaryPersistent(period);
+        potential[lev].FillBoundaryPersistent(period);
+
+        FillPhysicalBoundary(phi      [lev], geom[lev], bc, bc_val_phi);
+        FillPhysicalBoundary(solute   [lev], geom[lev], bc, bc_val_solute);
+        FillPhysicalBoundary(potential[lev], geom[lev], bc, bc_val_potential);
+    } else {
+        // post all three exchanges before waiting on any of them
+        FillStateBoundary_nowait(lev);
+        FillStateBoundary_finish(lev);
+    }
+}
+
+void Lithium::FillStateBoundary_nowait (int lev)
+{
+    AMREX_ASSERT(lev == 0);
+    if (Geometry::isAllPeriodic()) return;
+    const Periodicity& period = geom[lev].periodicity();
+
+    phi      [lev].FillBoundary_nowait(period);
+    solute   [lev].FillBoundary_nowait(period);
+    potential[lev].FillBoundary_nowait(period);
+}
+
+void Lithium::FillStateBoundary_finish (int lev)
+{
+    AMREX_ASSERT(lev == 0);
+    if (Geometry::isAllPeriodic()) return;
+
+    phi      [lev].FillBoundary_finish();
+    solute   [lev].FillBoundary_finish();
+    potential[lev].FillBoundary_finish();
 
-    const Box& domain_box = geom.Domain();
+    FillPhysicalBoundary(phi      [lev], geom[lev], bc, bc_val_phi);
+    FillPhysicalBoundary(solute   [lev], geom[lev], bc, bc_val_solute);
+    FillPhysicalBoundary(potential[lev], geom[lev], bc, bc_val_potential);
+}
+
+void Lithium::FillPhysicalBoundary (MultiFab& mf, const Geometry& geom, const Vector<BCRec>& bc, 
+                                    const Vector<amrex::Real>& bc_val, const int nComp)
+{
+    if (mf.nGrow() == 0) return;
+    LithiumPhysBC physbc(geom, bc, bc_val);
+    physbc.FillBoundary(mf, nComp, 1, 0.0, 0);
+}
+
+void Lithium::FillGhost (int lev, Vector<MultiFab>& mf, const Vector<amrex::Real>& bc_val)
+{
+    if (lev == 0) {
+        FillDirechletBoundary(mf[0], geom[0], bc, bc_val);
+    } else {
+        FillPatch(lev, mf[lev], mf, bc_val);
+    }
+}
+
+void Lithium::FillPatch (int lev, MultiFab& mf, Vector<MultiFab>& old_mf, const Vector<amrex::Real>& bc_val)
+{
+    const Real time = t_new[lev];
+
+    if (lev == 0)
+    {
+        LithiumPhysBC physbc(geom[lev], bc, bc_val);
+        amrex::FillPatchSingleLevel(mf, time, {&old_mf[lev]}, {time},
+                                    0, 0, 1, geom[lev], physbc, 0);
+    }
+    else
+    {
+        LithiumPhysBC cphysbc(geom[lev-1], bc, bc_val);
+        LithiumPhysBC fphysbc(geom[lev  ], bc, bc_val);
+        amrex::FillPatchTwoLevels(mf, time, {&old_mf[lev-1]}, {time}, {&old_mf[lev]}, {time},
+                                  0, 0, 1, geom[lev-1], geom[lev],
+                                  cphysbc, 0, fphysbc, 0,
+                                  refRatio(lev-1), &cell_cons_interp, bc, 0);
+    }
+}
+
+void Lithium::AverageDown (Vector<MultiFab>& mf)
+{
+    for (int lev = finest_level-1; lev >= 0; --lev)
+    {
+        amrex::average_down(mf[lev+1], mf[lev], geom[lev+1], geom[lev],
+                            0, mf[lev].nComp(), refRatio(lev));
+    }
+}
+
+void LithiumPhysBC::FillBoundary (MultiFab& mf, int dcomp, int ncomp, Real time, int bccomp)
+{
+    AMREX_ALWAYS_ASSERT(mf.ixType().cellCentered());
+    AMREX_ALWAYS_ASSERT(mf.nComp() >= dcomp + ncomp);
+
+    const Box& domain_box = m_geom.Domain();
     Box grown_domain_box = domain_box;
     for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
         if (Geometry::isPeriodic(idim)) {
@@ -272,9 +868,14 @@ void Lithium::FillDirechletBoundary (MultiFab& mf, const Geometry& geom, const V
     }
     // Inside grown_domain_box, we have good data.
 
-    const Real* dx = geom.CellSize();
+    const Real* dx = m_geom.CellSize();
     const Real* prob_lo = Geometry::ProbLo();
     
+    // amrex_user_fab_filcc fills all ghost cells of a fab, so no tiling here,
+    // the coarse patches of FillPatchTwoLevels have no ghost cells but may stick out of the domain
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
     for (MFIter mfi(mf); mfi.isValid(); ++mfi)
     {
         FArrayBox& fab = mf[mfi];
@@ -282,12 +883,15 @@ void Lithium::FillDirechletBoundary (MultiFab& mf, const Geometry& geom, const V
 
         if (! grown_domain_box.contains(fab_box))
         {
-            amrex_user_fab_filcc(BL_TO_FORTRAN_N_ANYD(fab,nComp),
-                BL_TO_FORTRAN_BOX(domain_box),
-                dx, 
-                prob_lo,
-                bc[0].data(),
-                bc_val.dataPtr());
+            for (int n = dcomp; n < dcomp + ncomp; ++n)
+            {
+                amrex_user_fab_filcc(BL_TO_FORTRAN_N_ANYD(fab,n),
+                    BL_TO_FORTRAN_BOX(domain_box),
+                    dx, 
+                    prob_lo,
+                    m_bc[bccomp].data(),
+                    m_bc_val.dataPtr());
+            }
         }
     }
 }
@@ -352,6 +956,31 @@ void Lithium::ReadParameters()
         pp.get("presmooth", presmooth);
         pp.get("postsmooth", postsmooth);
         pp.get("update_pot_interval", update_pot_interval);
+        pp.query("adaptive_potential", adaptive_potential);
+        pp.query("pot_rhs_tol", pot_rhs_tol);
+        pp.query("pot_phi_tol", pot_phi_tol);
+        pp.query("fused_update", fused_update);
+        pp.query("persistent_fb", persistent_fb);
+        pp.query("overlap_comm", overlap_comm);
+        pp.query("noise_amp", noise_amp);
+        pp.query("persistent_solver", persistent_solver);
+        pp.query("mg_smoother", mg_smoother);
+        pp.query("mg_cheby_degree", mg_cheby_degree);
+        pp.query("mg_sweeps_per_exchange", mg_sweeps_per_exchange);
+        pp.query("mg_wide_min_level", mg_wide_min_level);
+        pp.query("mg_packed_stencil", mg_packed_stencil);
+        pp.query("mg_incremental_coeffs", mg_incremental_coeffs);
+        pp.query("mg_mixed_precision", mg_mixed_precision);
+        pp.query("bottom_solver", bottom_solver);
+        pp.query("bottom_sstep", bottom_sstep);
+        if (bottom_solver < 0 || bottom_solver > 5) {
+            amrex::Abort("li.bottom_solver must be 0, 1, 2, 3, 4 or 5");
+        }
+        pp.query("implicit_solute", implicit_solute);
+        pp.query("solute_tol_rel", solute_tol_rel);
+        pp.query("tag_phi_min", tag_phi_min);
+        pp.query("tag_phi_max", tag_phi_max);
+        pp.query("tag_grad_phi", tag_grad_phi);
 
         pp.queryarr("bc_lo", bc_lo);
         pp.queryarr("bc_hi", bc_hi);
@@ -363,6 +992,22 @@ void Lithium::ReadParameters()
         pp.get("plot_step", plot_step);
         pp.get("dt", dt);
         pp.get("dt_init", dt_init);
+        pp.query("stop_time", stop_time);
+        pp.query("adaptive_dt", adaptive_dt);
+        pp.query("cfl", cfl);
+        pp.query("dt_change_max", dt_change_max);
+        pp.query("dphi_max", dphi_max);
+        pp.query("chk_step", chk_step);
+        pp.query("chk_async", chk_async);
+        pp.query("chk_compress", chk_compress);
+        pp.query("chk_file", chk_file);
+        pp.query("restart", restart_file);
+        pp.queryarr("plot_vars", plot_vars);
+        pp.query("plot_float", plot_float);
+        pp.query("plot_reuse", plot_reuse);
+        pp.query("plot_async", plot_async);
+        pp.query("plot_compress", plot_compress);
+        pp.query("plot_compress_tol", plot_compress_tol);
         pp.get("chemical_ratio", chemical_ratio);
         pp.get("start_write_plotfile", start_write_plotfile);
         pp.get("plot_pre_step", plot_pre_step);
@@ -370,6 +1015,10 @@ void Lithium::ReadParameters()
         pp.get("switch_step", switch_step);
         pp.get("switch_enable", switch_enable);
     }
+    {
+        ParmParse pp("amr");
+        pp.query("regrid_int", regrid_int);
+    }
 
     // in case changing temperature
     nFRT = ntrans * faraday / (gas * temperature);
@@ -431,41 +1080,6 @@ void Lithium::ReadParameters()
 
 void Lithium::InitData()
 {
-
-    // temporary init for single level only
-    grids[0] = MakeBaseGrids();
-    DistributionMapping dm(grids[0]);
-    SetDistributionMap(0, dm);
-
-    for (int lev = 0; lev <= max_level; lev++)
-    {
-        phi        [lev].define(grids[lev], dmap[lev], 1, 1);
-        phi_new    [lev].define(grids[lev], dmap[lev], 1, 1);
-        phi_dt     [lev].define(grids[lev], dmap[lev], 1, 1);
-        mu         [lev].define(grids[lev], dmap[lev], 1, 1);
-        solute_new [lev].define(grids[lev], dmap[lev], 1, 1);
-        solute     [lev].define(grids[lev], dmap[lev], 1, 1);
-        potential  [lev].define(grids[lev], dmap[lev], 1, 1);
-        rhs        [lev].define(grids[lev], dmap[lev], 1, 0);
-        acoef      [lev].define(grids[lev], dmap[lev], 1, 0);
-        bcoef      [lev].define(grids[lev], dmap[lev], 1, 1);
-        error      [lev].define(grids[lev], dmap[lev], 1, 0);
-        output     [lev].define(grids[lev], dmap[lev], 1, 0);
-
-        for(int idim = 0; idim< AMREX_SPACEDIM; ++idim)
-        {
-            grad[lev][idim].define(amrex::convert(grids[0],IntVect::TheDimensionVector(idim)),
-                                        dmap[0], 1, 0, MFInfo());
-        }
-
-    }
-
-    //
-    for (int lev = 0; lev <= max_level; lev++)
-    {
-        InitDataOnLevel(lev);
-    }
-    
     // pass the boundary condition to bc
     for (int n = 0; n < bc.size(); ++n)
     {
@@ -503,11 +1117,28 @@ void Lithium::InitData()
         }
     }
 
+    if (restart_file.empty()) {
+        // builds level 0 from MakeBaseGrids and the finer levels from ErrorEst
+        InitFromScratch(0.0);
+    } else {
+        ReadCheckpointFile();
+    }
 }
 
-void Lithium::InitDataOnLevel(int lev)
+void Lithium::DefineLevelData(int lev, const BoxArray& ba, const DistributionMapping& dm)
 {
-
+    phi        [lev].define(ba, dm, 1, 1);
+    phi_new    [lev].define(ba, dm, 1, 1);
+    phi_dt     [lev].define(ba, dm, 1, 1);
+    mu         [lev].define(ba, dm, 1, 1);
+    solute_new [lev].define(ba, dm, 1, 1);
+    solute     [lev].define(ba, dm, 1, 1);
+    potential  [lev].define(ba, dm, 1, 1);
+    rhs        [lev].define(ba, dm, 1, 0);
+    acoef      [lev].define(ba, dm, 1, 0);
+    bcoef      [lev].define(ba, dm, 1, 1);
+    error      [lev].define(ba, dm, 1, 0);
+    output     [lev].define(ba, dm, 1, 0);
 
     bcoef       [lev].setVal(0);
     rhs         [lev].setVal(0);
@@ -521,11 +1152,16 @@ void Lithium::InitDataOnLevel(int lev)
     error       [lev].setVal(0);
     phi_new     [lev].setVal(0);
     solute_new  [lev].setVal(0);
+}
 
-    for (MFIter mfi(phi[lev]); mfi.isValid(); ++mfi)
+void Lithium::InitDataOnLevel(int lev)
+{
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(phi[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
     {
-        const Box &bx = mfi.validbox();
-        const Box &gbx = mfi.fabbox();
+        const Box &bx = mfi.growntilebox();
 
         init_phi(BL_TO_FORTRAN_BOX(bx),
             BL_TO_FORTRAN_ANYD(phi[lev][mfi]),
@@ -549,6 +1185,10 @@ void Lithium::InitDataOnLevel(int lev)
 Vector<std::string>
 Lithium::PlotFileVarNames() const
 {
+    if (!plot_vars.empty()) {
+        return plot_vars;
+    }
+
     Vector<std::string> vname; // corresponding variable names
 
     vname.push_back("phi");
@@ -565,12 +1205,30 @@ Lithium::PlotFileVarNames() const
     return vname;
 }
 
+const Vector<MultiFab>&
+Lithium::PlotFileSource(const std::string& name) const
+{
+    if (name == "phi")       return phi;
+    if (name == "mu")        return mu;
+    if (name == "solute")    return solute;
+    if (name == "potential") return potential;
+    if (name == "rhs")       return rhs;
+    if (name == "phi_dt")    return phi_dt;
+    if (name == "bcoef")     return bcoef;
+    if (name == "phi_new")   return phi_new;
+    if (name == "error")     return error;
+    if (name == "output")    return output;
+
+    amrex::Abort("Lithium::PlotFileSource: unknown plot variable " + name);
+    return phi;
+}
+
 
 void
 Lithium::ChangeVoltage()
 {   
     voltage = 0.1;
-    for (int lev = 0; lev <= max_level; lev++)
+    for (int lev = 0; lev <= finest_level; lev++)
     {
         potential[lev].setVal(0);
         phi_dt[lev].setVal(0);
@@ -591,43 +1249,306 @@ Lithium::PlotFileName(int lev) const
 
 void Lithium::WritePlotFile()
 {
+    // one plotfile in flight at a time
+    WaitPlotFile();
+
     const std::string &plotfilename = PlotFileName(istep[0]);
     // const auto& mf = PlotFileMF();
     const auto &varnames = PlotFileVarNames();
 
-    Vector<MultiFab> plotData(max_level + 1);
+    const int ncomp = varnames.size();
 
-    // copy the components to plotData to write to plotfile
-    for (int lev = 0; lev <= max_level; lev++)
-    {
+    plot_data.resize(finest_level + 1);
 
-        plotData[lev].define(grids[lev], dmap[lev], varnames.size(), 0);
-        MultiFab::Copy(plotData[lev], phi[lev],       0, 0, 1, 0);
-        MultiFab::Copy(plotData[lev], mu[lev],        0, 1, 1, 0);
-        MultiFab::Copy(plotData[lev], solute[lev],    0, 2, 1, 0);
-        MultiFab::Copy(plotData[lev], potential[lev], 0, 3, 1, 0);
-        MultiFab::Copy(plotData[lev], rhs[lev],       0, 4, 1, 0);
-        MultiFab::Copy(plotData[lev], phi_dt[lev],    0, 5, 1, 0);
-        MultiFab::Copy(plotData[lev], bcoef[lev],     0, 6, 1, 0);
-        MultiFab::Copy(plotData[lev], phi_new[lev],   0, 7, 1, 0);
-        MultiFab::Copy(plotData[lev], error[lev],     0, 8, 1, 0);
-        MultiFab::Copy(plotData[lev], output[lev],    0, 9, 1, 0);
+    // copy the components to plot_data to write to plotfile, the staging
+    // data is only redefined when the grids changed since the last call
+    for (int lev = 0; lev <= finest_level; lev++)
+    {
+        if (!plot_data[lev].ok() || plot_data[lev].nComp() != ncomp
+            || plot_data[lev].boxArray() != grids[lev]
+            || plot_data[lev].DistributionMap() != dmap[lev])
+        {
+            plot_data[lev].define(grids[lev], dmap[lev], ncomp, 0);
+        }
+        for (int n = 0; n < ncomp; n++)
+        {
+            MultiFab::Copy(plot_data[lev], PlotFileSource(varnames[n])[lev], 0, n, 1, 0);
+        }
     }
     // istep[0] = istep[0] + 1;
-    amrex::Print() << "Writing plotfile " << plotfilename << "\n";
+    amrex::Print() << "Writing plotfile " << plotfilename
+                   << " at time " << t_new[0] << " with dt " << dt << "\n";
 
     // amrex::WriteMultiLevelPlotfile(plotfilename, max_level+1, mf, varnames,
     //         Geom(), t_new[0], istep, refRatio());
-    amrex::WriteMultiLevelPlotfile(plotfilename,
-                                   max_level + 1,
-                                   GetVecOfConstPtrs(plotData),
-                                   varnames,
-                                   Geom(),
-                                   t_new[0],
-                                   istep,
-                                   refRatio());
+    // VisMF converts the data through the RealDescriptor of the FAB format
+    const FABio::Format format = FArrayBox::getFormat();
+    if (plot_float) {
+        FArrayBox::setFormat(FABio::FAB_IEEE_32);
+    }
+    const VisMF::Header::Version version = VisMF::GetHeaderVersion();
+    const Real tol = VisMF::GetCompressionTol();
+    if (plot_compress) {
+        VisMF::SetHeaderVersion(VisMF::Header::Compressed_v1);
+        VisMF::SetCompressionTol(plot_compress_tol);
+    }
+
+    if (plot_async) {
+        plot_write = amrex::WriteMultiLevelPlotfileAsync(plotfilename,
+                                                         finest_level + 1,
+                                                         GetVecOfConstPtrs(plot_data),
+                                                         varnames,
+                                                         Geom(),
+                                                         t_new[0],
+                                                         istep,
+                                                         refRatio());
+    } else {
+        amrex::WriteMultiLevelPlotfile(plotfilename,
+                                       finest_level + 1,
+                                       GetVecOfConstPtrs(plot_data),
+                                       varnames,
+                                       Geom(),
+                                       t_new[0],
+                                       istep,
+                                       refRatio());
+    }
+
+    FArrayBox::setFormat(format);
+    VisMF::SetHeaderVersion(version);
+    VisMF::SetCompressionTol(tol);
+
+    if (!plot_reuse) {
+        plot_data.clear();
+    }
+}
+
+
+// chk0000100/Header     finest_level, istep, dt, t_new, the voltage state
+//                       and the BoxArray of each level
+// chk0000100/Level_0/   phi, solute, potential, phi_dt and mu of each level
+void Lithium::WriteCheckpointFile()
+{
+    // one checkpoint in flight at a time
+    WaitCheckpointFile();
+
+    const std::string& checkpointname = amrex::Concatenate(chk_file, istep[0], 7);
+
+    amrex::Print() << "Writing checkpoint " << checkpointname << "\n";
+
+    const int nlevels = finest_level + 1;
+
+    amrex::PreBuildDirectorHierarchy(checkpointname, "Level_", nlevels, true);
+
+    if (ParallelDescriptor::IOProcessor())
+    {
+        std::string HeaderFileName(checkpointname + "/Header");
+        VisMF::IO_Buffer io_buffer(VisMF::IO_Buffer_Size);
+        std::ofstream HeaderFile;
+        HeaderFile.rdbuf()->pubsetbuf(io_buffer.dataPtr(), io_buffer.size());
+        HeaderFile.open(HeaderFileName.c_str(), std::ofstream::out   |
+                                                std::ofstream::trunc |
+                                                std::ofstream::binary);
+        if( ! HeaderFile.good()) {
+            amrex::FileOpenFailed(HeaderFileName);
+        }
+
+        HeaderFile.precision(17);
+
+        HeaderFile << "Checkpoint file for Lithium\n";
+        HeaderFile << finest_level << "\n";
+
+        for (int lev = 0; lev <= finest_level; ++lev) {
+            HeaderFile << istep[lev] << " ";
+        }
+        HeaderFile << "\n";
+
+        HeaderFile << dt << "\n";
+
+        for (int lev = 0; lev <= finest_level; ++lev) {
+            HeaderFile << t_new[lev] << " ";
+        }
+        HeaderFile << "\n";
+
+        // ChangeVoltage changes voltage, plot_step and first_step_flag
+        HeaderFile << voltage << " " << plot_step << " " << first_step_flag << "\n";
+
+        for (int lev = 0; lev <= finest_level; ++lev) {
+            boxArray(lev).writeOn(HeaderFile);
+            HeaderFile << '\n';
+        }
+
+        // the state of the adaptive potential solve, 1 for the levels saved on the current grids
+        HeaderFile << pot_last_step << " " << pot_phi.size() << "\n";
+        for (int lev = 0; lev < pot_phi.size(); ++lev) {
+            HeaderFile << PotentialStateOnGrids(lev) << " ";
+        }
+        HeaderFile << "\n";
+    }
+
+    const Vector<std::pair<std::string, const Vector<MultiFab>*>> state {
+        {"phi", &phi}, {"solute", &solute}, {"potential", &potential}, {"phi_dt", &phi_dt}, {"mu", &mu}};
+
+    // the restart has to be exact, the checkpoint is never lossy
+    const VisMF::Header::Version version = VisMF::GetHeaderVersion();
+    const Real tol = VisMF::GetCompressionTol();
+    if (chk_compress) {
+        VisMF::SetHeaderVersion(VisMF::Header::Compressed_v1);
+        VisMF::SetCompressionTol(0.0);
+    }
+
+    for (int lev = 0; lev <= finest_level; ++lev)
+    {
+        for (const auto& s : state)
+        {
+            const std::string& name = amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", s.first);
+            if (chk_async) {
+                chk_writes.push_back(VisMF::WriteAsync((*s.second)[lev], name));
+            } else {
+                VisMF::Write((*s.second)[lev], name);
+            }
+        }
+    }
+
+    const Vector<std::pair<std::string, const Vector<MultiFab>*>> pot_state {
+        {"pot_phi", &pot_phi}, {"pot_phi_dt", &pot_phi_dt}};
+
+    for (int lev = 0; lev < pot_phi.size(); ++lev)
+    {
+        if (!PotentialStateOnGrids(lev)) {
+            continue;
+        }
+        for (const auto& s : pot_state)
+        {
+            const std::string& name = amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", s.first);
+            if (chk_async) {
+                chk_writes.push_back(VisMF::WriteAsync((*s.second)[lev], name));
+            } else {
+                VisMF::Write((*s.second)[lev], name);
+            }
+        }
+    }
+
+    VisMF::SetHeaderVersion(version);
+    VisMF::SetCompressionTol(tol);
+}
+
+void Lithium::WaitCheckpointFile()
+{
+    for (auto& f : chk_writes) {
+        f.get();
+    }
+    chk_writes.clear();
 }
 
+void Lithium::WaitPlotFile()
+{
+    if (plot_write.valid()) {
+        plot_write.get();
+    }
+}
+
+void Lithium::ReadCheckpointFile()
+{
+    amrex::Print() << "Restart from checkpoint " << restart_file << "\n";
+
+    std::string File(restart_file + "/Header");
+
+    Vector<char> fileCharPtr;
+    ParallelDescriptor::ReadAndBcastFile(File, fileCharPtr);
+    std::string fileCharPtrString(fileCharPtr.dataPtr());
+    std::istringstream is(fileCharPtrString, std::istringstream::in);
+
+    constexpr std::streamsize bl_ignore_max { 100000 };
+    std::string line;
+
+    // title line
+    std::getline(is, line);
+
+    is >> finest_level;
+    is.ignore(bl_ignore_max, '\n');
+    // the level vectors only hold max_level+1 levels
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(is && finest_level >= 0 && finest_level <= max_level,
+                                     "ReadCheckpointFile: finest_level of the checkpoint must be in [0, amr.max_level]");
+
+    for (int lev = 0; lev <= finest_level; ++lev) {
+        is >> istep[lev];
+    }
+    is.ignore(bl_ignore_max, '\n');
+
+    // a fixed step keeps li.dt of the inputs, the checkpoint dt may have been
+    // clipped to stop_time; the adaptive step limits its growth by the last dt
+    Real chk_dt;
+    is >> chk_dt;
+    is.ignore(bl_ignore_max, '\n');
+    if (adaptive_dt) {
+        dt = chk_dt;
+    }
+
+    for (int lev = 0; lev <= finest_level; ++lev) {
+        is >> t_new[lev];
+        t_old[lev] = t_new[lev] - dt;
+    }
+    is.ignore(bl_ignore_max, '\n');
+
+    is >> voltage >> plot_step >> first_step_flag;
+    is.ignore(bl_ignore_max, '\n');
+    SetLoValue(1, voltage, bc_val_potential);
+
+    for (int lev = 0; lev <= finest_level; ++lev)
+    {
+        BoxArray ba;
+        ba.readFrom(is);
+        is.ignore(bl_ignore_max, '\n');
+
+        DistributionMapping dm { ba, ParallelDescriptor::NProcs() };
+
+        SetBoxArray(lev, ba);
+        SetDistributionMap(lev, dm);
+        DefineLevelData(lev, ba, dm);
+    }
+
+    // checkpoints written before the adaptive potential solve have no state for it
+    int pot_nlevels = 0;
+    Vector<int> pot_on_grids;
+    if (is >> pot_last_step >> pot_nlevels)
+    {
+        pot_on_grids.resize(pot_nlevels);
+        for (int lev = 0; lev < pot_nlevels; ++lev) {
+            is >> pot_on_grids[lev];
+        }
+    }
+
+    const Vector<std::pair<std::string, Vector<MultiFab>*>> state {
+        {"phi", &phi}, {"solute", &solute}, {"potential", &potential}, {"phi_dt", &phi_dt}, {"mu", &mu}};
+
+    for (int lev = 0; lev <= finest_level; ++lev)
+    {
+        for (const auto& s : state)
+        {
+            VisMF::Read((*s.second)[lev],
+                        amrex::MultiFabFileFullPrefix(lev, restart_file, "Level_", s.first));
+        }
+    }
+
+    // the levels not saved on their grids stay undefined, PotentialNeedsUpdate skips them
+    const Vector<std::pair<std::string, Vector<MultiFab>*>> pot_state {
+        {"pot_phi", &pot_phi}, {"pot_phi_dt", &pot_phi_dt}};
+
+    pot_phi.resize(pot_nlevels);
+    pot_phi_dt.resize(pot_nlevels);
+    for (int lev = 0; lev < pot_nlevels; ++lev)
+    {
+        if (!pot_on_grids[lev]) {
+            continue;
+        }
+        for (const auto& s : pot_state)
+        {
+            (*s.second)[lev].define(grids[lev], dmap[lev], 1, 0);
+            VisMF::Read((*s.second)[lev],
+                        amrex::MultiFabFileFullPrefix(lev, restart_file, "Level_", s.first));
+        }
+    }
+}
 
 // Make a new level using provided BoxArray and DistributionMapping and
 // fill with interpolated coarse level data.
@@ -635,6 +1556,27 @@ void Lithium::WritePlotFile()
 void Lithium::MakeNewLevelFromCoarse(int lev, Real time, const BoxArray &ba,
                                     const DistributionMapping &dm)
 {
+    DefineLevelData(lev, ba, dm);
+
+    t_new[lev] = time;
+    t_old[lev] = time - dt;
+
+    const Vector<Real> bc_val_zero(AMREX_SPACEDIM * 2, 0.0);
+    const Vector<std::pair<Vector<MultiFab>*, const Vector<Real>*>> state {
+        {&phi, &bc_val_phi}, {&phi_dt, &bc_val_zero}, {&solute, &bc_val_solute},
+        {&potential, &bc_val_potential}, {&mu, &bc_val_mu}};
+
+    for (const auto& s : state)
+    {
+        Vector<MultiFab>& mf = *s.first;
+        LithiumPhysBC cphysbc(geom[lev-1], bc, *s.second);
+        LithiumPhysBC fphysbc(geom[lev  ], bc, *s.second);
+        amrex::InterpFromCoarseLevel(mf[lev], time, mf[lev-1], 0, 0, 1, geom[lev-1], geom[lev],
+                                     cphysbc, 0, fphysbc, 0, refRatio(lev-1),
+                                     &cell_cons_interp, bc, 0);
+    }
+
+    ClearSolvers();
 }
 
 // Remake an existing level using provided BoxArray and DistributionMapping and
@@ -643,12 +1585,49 @@ void Lithium::MakeNewLevelFromCoarse(int lev, Real time, const BoxArray &ba,
 void Lithium::RemakeLevel(int lev, Real time, const BoxArray &ba,
                         const DistributionMapping &dm)
 {
+    const Vector<Real> bc_val_zero(AMREX_SPACEDIM * 2, 0.0);
+    const Vector<std::pair<Vector<MultiFab>*, const Vector<Real>*>> state {
+        {&phi, &bc_val_phi}, {&phi_dt, &bc_val_zero}, {&solute, &bc_val_solute},
+        {&potential, &bc_val_potential}, {&mu, &bc_val_mu}};
+
+    Vector<MultiFab> new_state(state.size());
+    for (int i = 0; i < state.size(); ++i)
+    {
+        new_state[i].define(ba, dm, 1, 1);
+        FillPatch(lev, new_state[i], *state[i].first, *state[i].second);
+    }
+
+    // the work arrays are rebuilt on the new grids
+    DefineLevelData(lev, ba, dm);
+    for (int i = 0; i < state.size(); ++i)
+    {
+        std::swap((*state[i].first)[lev], new_state[i]);
+    }
+
+    t_new[lev] = time;
+    t_old[lev] = time - dt;
+
+    ClearSolvers();
 }
 
 // Delete level data
 // overrides the pure virtual function in AmrCore
 void Lithium::ClearLevel(int lev)
 {
+    phi         [lev].clear();
+    phi_new     [lev].clear();
+    phi_dt      [lev].clear();
+    mu          [lev].clear();
+    solute_new  [lev].clear();
+    solute      [lev].clear();
+    potential   [lev].clear();
+    rhs         [lev].clear();
+    acoef       [lev].clear();
+    bcoef       [lev].clear();
+    error       [lev].clear();
+    output      [lev].clear();
+
+    ClearSolvers();
 }
 
 // Make a new level from scratch using provided BoxArray and DistributionMapping.
@@ -657,10 +1636,49 @@ void Lithium::ClearLevel(int lev)
 void Lithium::MakeNewLevelFromScratch(int lev, Real time, const BoxArray &ba,
                                       const DistributionMapping &dm)
 {
+    DefineLevelData(lev, ba, dm);
+
+    t_new[lev] = time;
+    t_old[lev] = time - dt;
+
+    InitDataOnLevel(lev);
 }
 
 // tag all cells for refinement
 // overrides the pure virtual function in AmrCore
 void Lithium::ErrorEst(int lev, TagBoxArray &tags, Real time, int ngrow)
 {
+    const int tagval = TagBox::SET;
+
+    // the gradient criterion needs one layer of ghost cells
+    FillGhost(lev, phi, bc_val_phi);
+    MultiFab& state = phi[lev];
+
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    {
+        Vector<int> itags;
+
+        for (MFIter mfi(state, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& tilebox = mfi.tilebox();
+            TagBox& tagfab = tags[mfi];
+
+            // we cannot pass tagfab to Fortran because it is BaseFab<char>,
+            // so we are going to get a temporary integer array
+            tagfab.get_itags(itags, tilebox);
+
+            tag_interface(BL_TO_FORTRAN_BOX(tilebox),
+                itags.dataPtr(), BL_TO_FORTRAN_BOX(tilebox),
+                BL_TO_FORTRAN_ANYD(state[mfi]),
+                & tag_phi_min,
+                & tag_phi_max,
+                & tag_grad_phi,
+                & tagval
+            );
+
+            tagfab.tags(itags, tilebox);
+        }
+    }
 }